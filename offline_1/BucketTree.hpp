@@ -0,0 +1,174 @@
+#ifndef BUCKETTREE_H
+#define BUCKETTREE_H
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "SymbolInfo.hpp"
+#include "NodeStash.hpp"
+
+// Balanced search tree over one long bucket chain, as Java's HashMap does
+// for overfull bins. The chain itself is left in place, so print, forEach
+// and logged positions do not change; the tree finds a node, its chain
+// predecessor and its 1-based position in O(log n) instead of a walk.
+//
+// Every symbol in a bucket has the same bucket hash, so the tree is keyed
+// by name alone. Positions come from a Fenwick tree over sequence numbers
+// that increase along the chain; they are renumbered when they run out.
+class BucketTree{
+    struct Entry{
+        SymbolInfo* symbol;
+        SymbolInfo* prev; // chain predecessor, nullptr at the head
+        size_t seq;
+    };
+
+    typedef std::map<std::string_view, Entry> EntryMap;
+
+    EntryMap entries;
+    NodeStash<EntryMap> spareEntries; // kept by reset() for the next chain
+    std::vector<int> fenwick; // fenwick[i] sums live nodes over a range of seqs, 1-based
+    size_t nextSeq;
+    SymbolInfo* head;
+    SymbolInfo* tail;
+
+    void add(size_t seq, int delta){
+        for (size_t i = seq + 1; i < fenwick.size(); i += i & (~i + 1)){
+            fenwick[i] += delta;
+        }
+    }
+
+    // Live nodes with a sequence number <= seq.
+    int countUpTo(size_t seq) const {
+        int count = 0;
+        for (size_t i = seq + 1; i > 0; i -= i & (~i + 1)){
+            count += fenwick[i];
+        }
+        return count;
+    }
+
+    // Gives the chain seqs 0..n-1, with room for as many appends again.
+    // With holeBefore set, the seq just before that node is left unused.
+    void renumber(const SymbolInfo* holeBefore = nullptr){
+        size_t count = 0;
+        size_t hole = 0; // 1-based, 0 for none
+        for (SymbolInfo* current = head; current != nullptr; current = current -> getNext()){
+            if (current == holeBefore) hole = ++count;
+            entries.find(current -> getName()) -> second.seq = count++;
+        }
+        nextSeq = count;
+        fenwick.assign(2 * count + 17, 0);
+        for (size_t i = 1; i < fenwick.size(); i++){
+            if (i <= count && i != hole) fenwick[i] += 1;
+            size_t parent = i + (i & (~i + 1));
+            if (parent < fenwick.size()) fenwick[parent] += fenwick[i];
+        }
+    }
+
+   public:
+    explicit BucketTree(SymbolInfo* chain) : nextSeq(0), head(nullptr), tail(nullptr){
+        reset(chain);
+    }
+
+    // Starts over on another chain (nullptr for none), reusing the tree's
+    // nodes and Fenwick array, so a pooled tree refilled to its old size
+    // allocates nothing.
+    void reset(SymbolInfo* chain){
+        spareEntries.takeAll(entries);
+        head = chain;
+        tail = nullptr;
+        for (SymbolInfo* current = head; current != nullptr; current = current -> getNext()){
+            spareEntries.emplace(entries, current -> getName(), Entry{current, tail, 0});
+            tail = current;
+        }
+        renumber();
+    }
+
+    size_t size() const { return entries.size(); }
+    size_t capacity() const { return entries.size() + spareEntries.size(); }
+    SymbolInfo* getHead() const { return head; }
+
+    // Name comparisons a search costs, about log2 of the size.
+    int depth() const {
+        return entries.empty() ? 0 : 64 - __builtin_clzll(entries.size());
+    }
+
+    // position, if asked for, is the node's 1-based place in the chain.
+    SymbolInfo* find(const std::string& name, int* position = nullptr) const {
+        auto it = entries.find(name);
+        if (it == entries.end()) return nullptr;
+        if (position != nullptr) *position = countUpTo(it -> second.seq);
+        return it -> second.symbol;
+    }
+
+    // Links symbol after the current tail.
+    void append(SymbolInfo* symbol){
+        if (nextSeq + 1 >= fenwick.size()) renumber();
+        if (tail == nullptr)
+            head = symbol;
+        else
+            tail -> setNext(symbol);
+        spareEntries.emplace(entries, symbol -> getName(), Entry{symbol, tail, nextSeq});
+        add(nextSeq++, 1);
+        tail = symbol;
+    }
+
+    // Links symbol back in right after prev (nullptr for the head), as when
+    // undoing an unlink. The seq it had is normally still free, so this is
+    // O(log n); otherwise the chain is renumbered around a gap.
+    void insertAfter(SymbolInfo* symbol, SymbolInfo* prev){
+        SymbolInfo* next = prev == nullptr ? head : prev -> getNext();
+        if (next == nullptr){
+            symbol -> setNext(nullptr);
+            append(symbol);
+            return;
+        }
+        Entry& following = entries.find(next -> getName()) -> second;
+        size_t low = prev == nullptr ? 0 : entries.find(prev -> getName()) -> second.seq + 1;
+        if (low >= following.seq){
+            renumber(next);
+            low = following.seq - 1;
+        }
+        symbol -> setNext(next);
+        if (prev == nullptr)
+            head = symbol;
+        else
+            prev -> setNext(symbol);
+        following.prev = symbol;
+        spareEntries.emplace(entries, symbol -> getName(), Entry{symbol, prev, low});
+        add(low, 1);
+    }
+
+    // Takes the named symbol out of the chain and the tree without freeing
+    // it; nullptr if absent. The chain's new head is getHead(), and prev, if
+    // asked for, gets the node the symbol followed.
+    SymbolInfo* unlink(const std::string& name, int* position = nullptr, SymbolInfo** prev = nullptr){
+        auto it = entries.find(name);
+        if (it == entries.end()) return nullptr;
+        Entry entry = it -> second;
+        if (position != nullptr) *position = countUpTo(entry.seq);
+        if (prev != nullptr) *prev = entry.prev;
+
+        SymbolInfo* next = entry.symbol -> getNext();
+        if (entry.prev == nullptr)
+            head = next;
+        else
+            entry.prev -> setNext(next);
+        if (next == nullptr)
+            tail = entry.prev;
+        else
+            entries.find(next -> getName()) -> second.prev = entry.prev;
+
+        add(entry.seq, -1);
+        entries.erase(it);
+        return entry.symbol;
+    }
+
+    // Tree nodes are estimated as the entry plus the usual red-black header.
+    size_t bytes() const {
+        return sizeof(BucketTree) + (entries.size() + spareEntries.size()) * (sizeof(Entry) + sizeof(std::string_view) + 4 * sizeof(void*))
+               + fenwick.capacity() * sizeof(int);
+    }
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef BUILTINSCOPE_H
+#define BUILTINSCOPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Scope of names known at build time (library functions, predeclared types).
+// The whole table, hashes and bucket layout included, is computed by the
+// compiler and lands in read-only data, so it costs nothing at startup.
+// A SymbolTable given its view() through ScopeConfig::builtins searches it
+// after its global scope; it is reported as ScopeTable# 0.
+//
+//   constexpr BuiltinSymbol mySymbols[] = {{"printf", "FUNCTION,INT<==(STRING)"}, ...};
+//   static_assert(builtinNamesUnique(mySymbols), "duplicate builtin name");
+//   constexpr BuiltinScope<std::size(mySymbols)> myBuiltins(mySymbols);
+//
+// find stops at the first match, so a repeated name would hide its later
+// declarations; builtinNamesUnique lets the compiler reject them.
+
+struct BuiltinSymbol{
+    std::string_view name;
+    std::string_view type;
+};
+
+// FNV-1a, usable in constant expressions.
+constexpr uint32_t builtinHash(std::string_view str){
+    uint32_t hash = 2166136261u;
+    for (char c : str){
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+template <size_t N>
+constexpr bool builtinNamesUnique(const BuiltinSymbol (&symbols)[N]){
+    for (size_t i = 0; i < N; i++){
+        for (size_t j = i + 1; j < N; j++){
+            if (symbols[i].name == symbols[j].name) return false;
+        }
+    }
+    return true;
+}
+
+// Non-template handle on a BuiltinScope, what SymbolTable keeps.
+struct BuiltinScopeView{
+    const BuiltinSymbol* symbols;
+    const uint32_t* hashes;
+    const uint32_t* bucketStart; // bucket i holds symbols[bucketStart[i] .. bucketStart[i+1])
+    uint32_t num_buckets;
+
+    bool empty() const { return num_buckets == 0; }
+    uint32_t size() const { return empty() ? 0 : bucketStart[num_buckets]; }
+
+    // Index into symbols, or -1. bucket and position are 1-based, as in the log.
+    int find(std::string_view name, int* bucket = nullptr, int* position = nullptr) const {
+        if (empty()) return -1;
+        uint32_t hash = builtinHash(name);
+        uint32_t index = hash % num_buckets;
+        for (uint32_t i = bucketStart[index]; i < bucketStart[index + 1]; i++){
+            if (hashes[i] == hash && symbols[i].name == name){
+                if (bucket != nullptr) *bucket = index + 1;
+                if (position != nullptr) *position = i - bucketStart[index] + 1;
+                return i;
+            }
+        }
+        return -1;
+    }
+};
+
+template <size_t N>
+class BuiltinScope{
+    BuiltinSymbol symbols[N];
+    uint32_t hashes[N];
+    uint32_t bucketStart[N + 1];
+
+   public:
+    // Stable counting sort by bucket, so a bucket keeps declaration order.
+    constexpr BuiltinScope(const BuiltinSymbol (&input)[N]) : symbols{}, hashes{}, bucketStart{}{
+        for (size_t i = 0; i < N; i++){
+            bucketStart[builtinHash(input[i].name) % N + 1]++;
+        }
+        for (size_t b = 0; b < N; b++){
+            bucketStart[b + 1] += bucketStart[b];
+        }
+        uint32_t fill[N + 1] = {};
+        for (size_t i = 0; i < N; i++){
+            uint32_t hash = builtinHash(input[i].name);
+            uint32_t slot = bucketStart[hash % N] + fill[hash % N]++;
+            symbols[slot] = input[i];
+            hashes[slot] = hash;
+        }
+    }
+
+    constexpr BuiltinScopeView view() const {
+        return {symbols, hashes, bucketStart, N};
+    }
+};
+
+// Standard C names a lexer or parser can preload for free.
+constexpr BuiltinSymbol C_BUILTIN_SYMBOLS[] = {
+    {"int", "TYPE"},
+    {"char", "TYPE"},
+    {"float", "TYPE"},
+    {"double", "TYPE"},
+    {"void", "TYPE"},
+    {"printf", "FUNCTION,INT<==(STRING)"},
+    {"scanf", "FUNCTION,INT<==(STRING)"},
+    {"malloc", "FUNCTION,VOID*<==(INT)"},
+    {"free", "FUNCTION,VOID<==(VOID*)"},
+    {"strlen", "FUNCTION,INT<==(STRING)"},
+    {"exit", "FUNCTION,VOID<==(INT)"},
+};
+
+static_assert(builtinNamesUnique(C_BUILTIN_SYMBOLS), "duplicate builtin name");
+constexpr BuiltinScope<sizeof(C_BUILTIN_SYMBOLS) / sizeof(BuiltinSymbol)> C_BUILTINS(C_BUILTIN_SYMBOLS);
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef CONCURRENTSYMBOLTABLE_H
+#define CONCURRENTSYMBOLTABLE_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Hashfunctions.hpp"
+
+// Symbol table for one writer thread and any number of reader threads.
+// Readers never lock: every link is an atomic pointer published with release
+// stores, and anything the writer unlinks (a removed symbol or an exited
+// scope) is retired and only freed once no reader can still be looking at it
+// (epoch based reclamation).
+//
+// Only one thread may call insert / remove / enterScope / exitScope.
+// lookup may be called from any thread, but only while a ReadGuard is alive
+// on that thread, and the returned pointer is valid until the guard dies.
+class ConcurrentSymbolTable{
+   public:
+    class Node{
+        std::string name;
+        std::string type;
+        std::atomic<Node*> next;
+        friend class ConcurrentSymbolTable;
+
+       public:
+        Node(const std::string& name, const std::string& type)
+        : name(name), type(type), next(nullptr) {}
+
+        const std::string& getName() const { return name; }
+        const std::string& getType() const { return type; }
+    };
+
+   private:
+    struct Scope{
+        std::atomic<Node*>* buckets;
+        int num_buckets;
+        Scope* parent;
+        int id;
+
+        Scope(int n, Scope* parent, int id)
+        : num_buckets(n), parent(parent), id(id){
+            buckets = new std::atomic<Node*>[num_buckets];
+            for (int i = 0; i < num_buckets; i++){
+                buckets[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        ~Scope(){
+            for (int i = 0; i < num_buckets; i++){
+                Node* current = buckets[i].load(std::memory_order_relaxed);
+                while (current != nullptr){
+                    Node* next = current -> next.load(std::memory_order_relaxed);
+                    delete current;
+                    current = next;
+                }
+            }
+            delete [] buckets;
+        }
+    };
+
+    struct Retired{
+        unsigned long epoch;
+        Node* node;
+        Scope* scope;
+    };
+
+    static const int MAX_READERS = 128;
+    static const int COLLECT_EVERY = 64;
+
+    // A reader slot holds 0 when idle, otherwise (epoch << 1) | 1.
+    std::atomic<unsigned long> globalEpoch;
+    std::atomic<unsigned long> readerSlots[MAX_READERS];
+    std::atomic<Scope*> currentScope;
+
+    // writer-only state
+    std::vector<Retired> retired;
+    int num_buckets;
+    int nextId;
+    unsigned long (*hashfunc) (const std::string&, const int);
+
+    unsigned long indexOf(const std::string& name, int n) const {
+        return hashfunc(name, n) % n;
+    }
+
+    void retire(Node* node, Scope* scope){
+        retired.push_back({globalEpoch.load(std::memory_order_relaxed), node, scope});
+        if (retired.size() % COLLECT_EVERY == 0){
+            collect();
+        }
+    }
+
+    // Moves the global epoch forward if every pinned reader has seen it.
+    bool tryAdvance(){
+        unsigned long epoch = globalEpoch.load(std::memory_order_relaxed);
+        for (int i = 0; i < MAX_READERS; i++){
+            unsigned long slot = readerSlots[i].load(std::memory_order_seq_cst);
+            if ((slot & 1) && (slot >> 1) != epoch) return false;
+        }
+        globalEpoch.store(epoch + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+   public:
+    // Pins the calling thread to the current epoch for its lifetime.
+    class ReadGuard{
+        ConcurrentSymbolTable& table;
+        int slot;
+
+       public:
+        ReadGuard(ConcurrentSymbolTable& t) : table(t), slot(-1){
+            unsigned long epoch = table.globalEpoch.load(std::memory_order_relaxed);
+            while (slot < 0){
+                for (int i = 0; i < MAX_READERS; i++){
+                    unsigned long idle = 0;
+                    if (table.readerSlots[i].compare_exchange_strong(idle, (epoch << 1) | 1,
+                                                                     std::memory_order_seq_cst)){
+                        slot = i;
+                        break;
+                    }
+                }
+                if (slot < 0) std::this_thread::yield();
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        ~ReadGuard(){
+            table.readerSlots[slot].store(0, std::memory_order_release);
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+
+    ConcurrentSymbolTable(int n, unsigned long (*func) (const std::string&, const int) = SDBMHash)
+    : globalEpoch(0), num_buckets(n), nextId(1), hashfunc(func){
+        for (int i = 0; i < MAX_READERS; i++){
+            readerSlots[i].store(0, std::memory_order_relaxed);
+        }
+        currentScope.store(new Scope(n, nullptr, nextId++), std::memory_order_release);
+    }
+
+    // No reader may be active while the table is destroyed.
+    ~ConcurrentSymbolTable(){
+        for (size_t i = 0; i < retired.size(); i++){
+            delete retired[i].node;
+            delete retired[i].scope;
+        }
+        Scope* curr = currentScope.load(std::memory_order_relaxed);
+        while (curr != nullptr){
+            Scope* parent = curr -> parent;
+            delete curr;
+            curr = parent;
+        }
+    }
+
+    ConcurrentSymbolTable(const ConcurrentSymbolTable&) = delete;
+    ConcurrentSymbolTable& operator=(const ConcurrentSymbolTable&) = delete;
+
+    void enterScope(){
+        Scope* parent = currentScope.load(std::memory_order_relaxed);
+        currentScope.store(new Scope(num_buckets, parent, nextId++), std::memory_order_release);
+    }
+
+    bool exitScope(){
+        Scope* curr = currentScope.load(std::memory_order_relaxed);
+        if (curr -> parent == nullptr) return false; // cannot exit the global scope
+
+        currentScope.store(curr -> parent, std::memory_order_release);
+        retire(nullptr, curr);
+        return true;
+    }
+
+    bool insert(const std::string& name, const std::string& type){
+        Scope* scope = currentScope.load(std::memory_order_relaxed);
+        std::atomic<Node*>* link = &scope -> buckets[indexOf(name, scope -> num_buckets)];
+        Node* current = link -> load(std::memory_order_relaxed);
+
+        while (current != nullptr){
+            if (current -> name == name) return false; // already exists
+            link = &current -> next;
+            current = link -> load(std::memory_order_relaxed);
+        }
+
+        // the node is fully built before it becomes reachable
+        link -> store(new Node(name, type), std::memory_order_release);
+        return true;
+    }
+
+    bool remove(const std::string& name){
+        Scope* scope = currentScope.load(std::memory_order_relaxed);
+        std::atomic<Node*>* link = &scope -> buckets[indexOf(name, scope -> num_buckets)];
+        Node* current = link -> load(std::memory_order_relaxed);
+
+        while (current != nullptr){
+            Node* next = current -> next.load(std::memory_order_relaxed);
+            if (current -> name == name){
+                // readers already on 'current' still see a valid next pointer
+                link -> store(next, std::memory_order_release);
+                retire(current, nullptr);
+                return true;
+            }
+            link = &current -> next;
+            current = next;
+        }
+        return false; //symbol not found
+    }
+
+    // Safe from any thread holding a ReadGuard.
+    const Node* lookup(const std::string& name, int* scopeId = nullptr) const {
+        Scope* curr = currentScope.load(std::memory_order_acquire);
+
+        while (curr != nullptr){
+            Node* current = curr -> buckets[indexOf(name, curr -> num_buckets)].load(std::memory_order_acquire);
+            while (current != nullptr){
+                if (current -> name == name){
+                    if (scopeId != nullptr) *scopeId = curr -> id;
+                    return current;
+                }
+                current = current -> next.load(std::memory_order_acquire);
+            }
+            curr = curr -> parent;
+        }
+        return nullptr;
+    }
+
+    // Frees every retired object no reader can still reach. Writer only.
+    size_t collect(){
+        tryAdvance();
+        unsigned long epoch = globalEpoch.load(std::memory_order_seq_cst);
+        size_t kept = 0, freed = 0;
+
+        for (size_t i = 0; i < retired.size(); i++){
+            if (retired[i].epoch + 2 <= epoch){
+                delete retired[i].node;
+                delete retired[i].scope;
+                freed++;
+            } else {
+                retired[kept++] = retired[i];
+            }
+        }
+        retired.resize(kept);
+        return freed;
+    }
+
+    size_t pendingRetired() const { return retired.size(); }
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef NODESTASH_H
+#define NODESTASH_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Keeps the nodes of an emptied std::map or std::unordered_map for later
+// inserts (C++17 node handles), so a container refilled to its old size
+// allocates nothing. Nodes keep their key and value objects, which are
+// assigned over when reused.
+template <class Map>
+class NodeStash{
+    std::vector<typename Map::node_type> nodes;
+
+   public:
+    NodeStash() {}
+    // A copy of the container it serves does not need its spares.
+    NodeStash(const NodeStash&) {}
+    NodeStash& operator=(const NodeStash&){ return *this; }
+    NodeStash(NodeStash&&) = default;
+    NodeStash& operator=(NodeStash&&) = default;
+
+    // Empties map into the stash.
+    void takeAll(Map& map){
+        while (!map.empty()){
+            nodes.push_back(map.extract(map.begin()));
+        }
+    }
+
+    // map.emplace(key, value) on a stashed node when there is one.
+    template <class Key, class Value>
+    void emplace(Map& map, const Key& key, const Value& value){
+        if (nodes.empty()){
+            map.emplace(key, value);
+            return;
+        }
+        typename Map::node_type node = std::move(nodes.back());
+        nodes.pop_back();
+        node.key() = key;
+        node.mapped() = value;
+        auto result = map.insert(std::move(node));
+        if (!result.inserted) nodes.push_back(std::move(result.node));
+    }
+
+    size_t size() const { return nodes.size(); }
+
+    // Frees up to count stashed nodes; returns how many it freed.
+    size_t drop(size_t count){
+        size_t dropped = std::min(count, nodes.size());
+        nodes.resize(nodes.size() - dropped);
+        return dropped;
+    }
+
+    void swap(NodeStash& other) noexcept {
+        nodes.swap(other.nodes);
+    }
+};
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef PERFECTHASHINDEX_H
+#define PERFECTHASHINDEX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "SymbolInfo.hpp"
+
+// Minimal perfect hash over the names of a frozen ScopeTable (hash and
+// displace): names are split into small groups, and each group gets the
+// first seed that sends all its names to free slots of a dense array with
+// exactly one slot per name. A lookup is then one slot and one compare.
+// The slot also records where the symbol sits in its chain, so a frozen
+// scope logs the same positions as a walk would.
+class PerfectHashIndex{
+    struct Entry{
+        uint64_t hash;
+        SymbolInfo* symbol;
+        uint32_t bucket;  // 0-based chain the symbol is in
+        int position;     // 1-based place in that chain
+    };
+
+    std::vector<uint32_t> seeds; // one per group
+    std::vector<Entry> entries;  // one per name
+
+    static uint64_t mix(uint64_t x){
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // Maps x onto [0, n) without a division.
+    static uint64_t reduce(uint64_t x, uint64_t n){
+        return (uint64_t) (((unsigned __int128) x * n) >> 64);
+    }
+
+    uint64_t slotOf(uint64_t hash, uint32_t seed) const {
+        return reduce(mix(hash ^ (seed * 0x9e3779b97f4a7c15ULL)), entries.size());
+    }
+
+    uint64_t groupOf(uint64_t hash) const {
+        return reduce(hash, seeds.size());
+    }
+
+   public:
+    static uint64_t hashName(std::string_view name){
+        uint64_t hash = 14695981039346656037ULL;
+        for (char c : name){
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return mix(hash);
+    }
+
+    // Symbols given as (symbol, bucket, position). False if no layout was
+    // found, which only happens when two names share a 64-bit hash.
+    template <class Source>
+    bool build(Source forEachSymbol){
+        std::vector<Entry> pending;
+        forEachSymbol([&](SymbolInfo* symbol, size_t bucket, int position){
+            pending.push_back({hashName(symbol -> getName()), symbol, (uint32_t) bucket, position});
+        });
+        entries.assign(pending.size(), Entry{0, nullptr, 0, 0});
+        seeds.assign(pending.size() / 4 + 1, 0);
+        if (pending.empty()) return true;
+
+        std::vector<std::vector<uint32_t>> groups(seeds.size());
+        for (uint32_t i = 0; i < pending.size(); i++){
+            groups[groupOf(pending[i].hash)].push_back(i);
+        }
+        std::vector<uint32_t> order(groups.size());
+        for (uint32_t g = 0; g < order.size(); g++) order[g] = g;
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){
+            return groups[a].size() > groups[b].size();
+        });
+
+        // biggest groups first, while the array is still mostly free
+        std::vector<bool> taken(entries.size(), false);
+        std::vector<uint64_t> slots;
+        for (uint32_t g : order){
+            if (groups[g].empty()) break;
+            bool placed = false;
+            for (uint32_t seed = 1; seed < (1u << 24) && !placed; seed++){
+                slots.clear();
+                placed = true;
+                for (uint32_t i : groups[g]){
+                    uint64_t slot = slotOf(pending[i].hash, seed);
+                    if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()){
+                        placed = false;
+                        break;
+                    }
+                    slots.push_back(slot);
+                }
+                if (placed){
+                    seeds[g] = seed;
+                    for (size_t k = 0; k < slots.size(); k++){
+                        taken[slots[k]] = true;
+                        entries[slots[k]] = pending[groups[g][k]];
+                    }
+                }
+            }
+            if (!placed) return false;
+        }
+        return true;
+    }
+
+    size_t size() const { return entries.size(); }
+
+    // The symbol, with its chain bucket and position, or nullptr.
+    SymbolInfo* find(const std::string& name, unsigned long* bucket = nullptr, int* position = nullptr) const {
+        if (entries.empty()) return nullptr;
+        uint64_t hash = hashName(name);
+        const Entry& entry = entries[slotOf(hash, seeds[groupOf(hash)])];
+        if (entry.hash != hash || entry.symbol -> getName() != name) return nullptr;
+        if (bucket != nullptr) *bucket = entry.bucket;
+        if (position != nullptr) *position = entry.position;
+        return entry.symbol;
+    }
+
+    size_t bytes() const {
+        return sizeof(PerfectHashIndex) + seeds.capacity() * sizeof(uint32_t) + entries.capacity() * sizeof(Entry);
+    }
+};
+
+#endif
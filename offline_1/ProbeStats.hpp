@@ -0,0 +1,76 @@
+#ifndef PROBESTATS_H
+#define PROBESTATS_H
+
+#include <iostream>
+#include <vector>
+
+// Lookup cost of a ScopeTable, or summed over a SymbolTable's scopes.
+// A probe is one name comparison against a chain node. The counters are
+// bumped on every lookup; the chain-length histogram is only built when the
+// stats are requested, so leaving them on costs a few increments.
+struct ProbeStats{
+    unsigned long long hits = 0;
+    unsigned long long hitProbes = 0;
+    unsigned long long misses = 0;
+    unsigned long long missProbes = 0;
+    std::vector<unsigned long long> chainLengths; // chainLengths[k] = buckets holding k symbols
+    size_t maxChain = 0;
+    unsigned long long moves = 0; // hits relinked toward the head (BucketPolicy)
+
+    // SymbolTable::lookup only: how many scopes each call had to search
+    unsigned long long symbolLookups = 0;
+    unsigned long long scopesVisited = 0;
+
+    void addChain(size_t length){
+        if (chainLengths.size() <= length) chainLengths.resize(length + 1, 0);
+        chainLengths[length]++;
+        if (length > maxChain) maxChain = length;
+    }
+
+    double probesPerHit() const {
+        return hits == 0 ? 0.0 : hitProbes / (hits * 1.0);
+    }
+
+    double probesPerMiss() const {
+        return misses == 0 ? 0.0 : missProbes / (misses * 1.0);
+    }
+
+    double scopesPerLookup() const {
+        return symbolLookups == 0 ? 0.0 : scopesVisited / (symbolLookups * 1.0);
+    }
+
+    ProbeStats& operator+=(const ProbeStats& other){
+        hits += other.hits;
+        hitProbes += other.hitProbes;
+        misses += other.misses;
+        missProbes += other.missProbes;
+        for (size_t k = 0; k < other.chainLengths.size(); k++){
+            if (other.chainLengths[k] == 0) continue;
+            if (chainLengths.size() <= k) chainLengths.resize(k + 1, 0);
+            chainLengths[k] += other.chainLengths[k];
+        }
+        if (other.maxChain > maxChain) maxChain = other.maxChain;
+        moves += other.moves;
+        symbolLookups += other.symbolLookups;
+        scopesVisited += other.scopesVisited;
+        return *this;
+    }
+
+    void printJson(std::ostream& os) const {
+        os << "{\"hits\":" << hits << ",\"hitProbes\":" << hitProbes
+           << ",\"misses\":" << misses << ",\"missProbes\":" << missProbes
+           << ",\"probesPerHit\":" << probesPerHit()
+           << ",\"probesPerMiss\":" << probesPerMiss()
+           << ",\"moves\":" << moves
+           << ",\"maxChain\":" << maxChain << ",\"chainLengths\":[";
+        for (size_t k = 0; k < chainLengths.size(); k++){
+            if (k > 0) os << ",";
+            os << chainLengths[k];
+        }
+        os << "],\"symbolLookups\":" << symbolLookups
+           << ",\"scopesVisited\":" << scopesVisited
+           << ",\"scopesPerLookup\":" << scopesPerLookup() << "}";
+    }
+};
+
+#endif
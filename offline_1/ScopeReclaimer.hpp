@@ -0,0 +1,202 @@
+#ifndef SCOPERECLAIMER_H
+#define SCOPERECLAIMER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "ScopeTable.hpp"
+
+// Frees the scopes a SymbolTable exits away from the call that exited them,
+// so leaving a large scope (a long function body) costs O(1) there instead
+// of a walk over all its nodes. Under ReclaimMode::Background a worker
+// thread frees them; under ReclaimMode::Amortized step() frees config's
+// reclaimStep nodes at a time and the table calls it on its inserts,
+// removes and scope changes. Scopes waiting to be freed are bounded by
+// reclaimLimit bytes, as counted by their allocatedBytes: past it, retire
+// first waits for the worker, or frees older scopes itself, until the new
+// one fits. Every table has its own, forks and clones included, so under
+// ReclaimMode::Background each one runs a thread.
+//
+// A retired scope's stats, histogram included, are gathered while it is
+// freed; stats() waits until every pending scope has been. Scopes must be
+// silent (see BasicScopeTable::setSilentExit), since nothing they log on
+// the way out would be in order.
+template <class ScopeType>
+class ScopeReclaimer{
+    struct Pending{
+        std::shared_ptr<ScopeType> scope;
+        bool counted;     // its stats go into reclaimed
+        size_t bytes;
+        ScopeStats stats; // gathered as it is shed
+        size_t carried;   // see BasicScopeTable::shed
+        std::shared_ptr<const ScopeType> base; // of a copy-on-write scope, once shed
+    };
+
+    ReclaimMode mode;
+    size_t limit;
+    size_t stepSize;
+    std::deque<Pending> pending;
+    size_t pendingBytes;
+    size_t unfinished; // pending, plus the one the worker holds
+    ScopeStats reclaimed;
+    // Background only: guards everything above, and the worker waits on
+    // work, retire and drain on done.
+    std::mutex lock;
+    std::condition_variable work, done;
+    bool stopping;
+    std::thread worker;
+
+    // Frees about budget of entry's scope and returns how much it freed;
+    // less than budget once it is all gone. Only the last holder of a scope
+    // may shed it: one still shared with a fork is counted (by a walk of
+    // its chains) and let go.
+    size_t shed(Pending& entry, size_t budget){
+        if (entry.scope.use_count() > 1){
+            if (entry.counted) entry.stats = entry.scope -> stats();
+            entry.scope.reset();
+            return 0;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire); // after other holders' last reads
+        size_t freed = entry.scope -> shed(budget, entry.stats.probes, entry.carried);
+        if (freed >= budget) return freed;
+
+        // every bucket shed() did not finish was empty
+        size_t chains = 0;
+        for (unsigned long long count : entry.stats.probes.chainLengths){
+            chains += count;
+        }
+        entry.stats.probes.addChain(0);
+        entry.stats.probes.chainLengths[0] += entry.stats.buckets - chains - 1;
+        entry.base = entry.scope -> takeBase();
+        entry.scope.reset();
+        return freed;
+    }
+
+    // entry is freed; its base, if nothing else holds it, is queued in turn.
+    void finish(Pending& entry){
+        if (entry.counted) reclaimed += entry.stats;
+        pendingBytes -= entry.bytes;
+        unfinished--;
+        if (entry.base != nullptr && entry.base.use_count() == 1){
+            pending.push_back({std::const_pointer_cast<ScopeType>(entry.base), false, 0, ScopeStats(), 0, nullptr});
+            unfinished++;
+        }
+    }
+
+    // Works through the front of the queue until budget is spent.
+    void reclaim(size_t budget){
+        while (budget > 0 && !pending.empty()){
+            size_t freed = shed(pending.front(), budget);
+            if (freed >= budget) return;
+            finish(pending.front());
+            pending.pop_front();
+            budget -= freed;
+        }
+    }
+
+    void run(){
+        std::unique_lock<std::mutex> guard(lock);
+        while (true){
+            work.wait(guard, [&]{ return stopping || !pending.empty(); });
+            if (pending.empty()) return;
+            Pending entry = std::move(pending.front());
+            pending.pop_front();
+            guard.unlock();
+            shed(entry, SIZE_MAX);
+            guard.lock();
+            finish(entry);
+            done.notify_all();
+        }
+    }
+
+   public:
+    ScopeReclaimer(const ScopeConfig& config)
+    : mode(config.reclaim), limit(config.reclaimLimit), stepSize(config.reclaimStep), pendingBytes(0),
+      unfinished(0), stopping(false){
+        if (mode == ReclaimMode::Background) worker = std::thread(&ScopeReclaimer::run, this);
+    }
+
+    ScopeReclaimer(const ScopeReclaimer&) = delete;
+    ScopeReclaimer& operator=(const ScopeReclaimer&) = delete;
+
+    // Frees whatever is still pending.
+    ~ScopeReclaimer(){
+        drain();
+        if (worker.joinable()){
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            work.notify_all();
+            worker.join();
+        }
+    }
+
+    // Takes over an exited scope, which nobody may use any more; with
+    // counted, its stats are added to stats() once it is freed.
+    void retire(std::shared_ptr<ScopeType> scope, bool counted){
+        ScopeStats stats = scope -> statsWithoutChains();
+        size_t bytes = stats.allocatedBytes;
+        Pending entry{std::move(scope), counted, bytes, stats, 0, nullptr};
+        if (mode == ReclaimMode::Amortized){
+            while (unfinished > 0 && pendingBytes + bytes > limit){
+                reclaim(stepSize);
+            }
+            pending.push_back(std::move(entry));
+            pendingBytes += bytes;
+            unfinished++;
+            return;
+        }
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [&]{ return unfinished == 0 || pendingBytes + bytes <= limit; });
+        pending.push_back(std::move(entry));
+        pendingBytes += bytes;
+        unfinished++;
+        work.notify_one();
+    }
+
+    // One amortized step: frees up to reclaimStep nodes. Does nothing in
+    // the other modes.
+    void step(){
+        if (mode == ReclaimMode::Amortized && !pending.empty()) reclaim(stepSize);
+    }
+
+    // Returns once every scope retired so far has been freed.
+    void drain(){
+        if (mode == ReclaimMode::Amortized){
+            while (!pending.empty()){
+                reclaim(SIZE_MAX);
+            }
+            return;
+        }
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [&]{ return unfinished == 0; });
+    }
+
+    // Bytes of retired scopes not yet freed.
+    size_t pendingSize(){
+        if (mode == ReclaimMode::Amortized) return pendingBytes;
+        std::lock_guard<std::mutex> guard(lock);
+        return pendingBytes;
+    }
+
+    // Stats of every counted scope retired so far; waits for them to be freed.
+    ScopeStats stats(){
+        drain();
+        std::lock_guard<std::mutex> guard(lock);
+        return reclaimed;
+    }
+
+    // Starts stats() over: scopes retired before are no longer counted.
+    void forgetStats(){
+        drain();
+        std::lock_guard<std::mutex> guard(lock);
+        reclaimed = ScopeStats();
+    }
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SCOPESTATS_H
+#define SCOPESTATS_H
+
+#include <iostream>
+#include "ProbeStats.hpp"
+
+// Operation and allocation counts of a ScopeTable. SymbolTable folds the
+// stats of each scope into a running total when the scope exits, so the
+// lifetime view covers every scope ever created, not just the live ones.
+struct ScopeStats{
+    int scopes = 0;
+    size_t buckets = 0;
+    double collisions = 0;
+    unsigned long long inserts = 0;
+    unsigned long long duplicates = 0;  // inserts refused, name already there
+    unsigned long long removes = 0;
+    unsigned long long failedRemoves = 0;
+    unsigned long long allocations = 0; // scope objects, bucket arrays and nodes
+    unsigned long long allocatedBytes = 0;
+    ProbeStats probes;
+
+    // Every scope of a SymbolTable has the same bucket count, so this equals
+    // the average of the per-scope ratios SymbolTable::getRatio reports.
+    double collisionRatio() const {
+        return buckets == 0 ? 0.0 : collisions / (buckets * 1.0);
+    }
+
+    ScopeStats& operator+=(const ScopeStats& other){
+        scopes += other.scopes;
+        buckets += other.buckets;
+        collisions += other.collisions;
+        inserts += other.inserts;
+        duplicates += other.duplicates;
+        removes += other.removes;
+        failedRemoves += other.failedRemoves;
+        allocations += other.allocations;
+        allocatedBytes += other.allocatedBytes;
+        probes += other.probes;
+        return *this;
+    }
+
+    void printJson(std::ostream& os) const {
+        os << "{\"scopes\":" << scopes << ",\"buckets\":" << buckets
+           << ",\"collisions\":" << collisions << ",\"collisionRatio\":" << collisionRatio()
+           << ",\"inserts\":" << inserts << ",\"duplicates\":" << duplicates
+           << ",\"removes\":" << removes << ",\"failedRemoves\":" << failedRemoves
+           << ",\"allocations\":" << allocations << ",\"allocatedBytes\":" << allocatedBytes
+           << ",\"probes\":";
+        probes.printJson(os);
+        os << "}";
+    }
+};
+
+#endif
@@ -3,70 +3,730 @@
 
 #include "SymbolInfo.hpp"
 #include "Hashfunctions.hpp"
+#include "MemoryStats.hpp"
+#include "ScopeStats.hpp"
+#include "BuiltinScope.hpp"
+#include "TableLogger.hpp"
+#include "BucketTree.hpp"
+#include "SuggestIndex.hpp"
+#include "PerfectHashIndex.hpp"
+#include "NodeStash.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-class ScopeTable{
-    SymbolInfo** buckets;
+// Order of a bucket's chain. New symbols always go to the tail; under
+// MoveToFront a lookup hit is relinked at the head, under Transpose it swaps
+// places with its predecessor, so hot names drift toward the front. Logged
+// positions are where the symbol sits when the operation runs, so a Found
+// line shows the position before the move and later lines and prints show
+// the reordered chain. A bucket turned into a BucketTree (see
+// ScopeConfig::treeifyThreshold) keeps insertion order whatever the policy.
+enum class BucketPolicy{
+    InsertionOrder,
+    MoveToFront,
+    Transpose,
+};
+
+// How a SymbolTable frees the scopes it exits (see ScopeReclaimer.hpp):
+// on the spot, on a background thread, or a few nodes per later insert,
+// remove or scope change.
+enum class ReclaimMode{
+    Inline,
+    Background,
+    Amortized,
+};
+
+// Per-table settings. A SymbolTable hands the same copy to every scope it
+// creates, so two tables can use different hashes and sinks side by side.
+struct ScopeConfig{
+    unsigned long (*hashfunc) (const std::string&, const int) = SDBMHash;
+    std::ostream* os = nullptr;            // sink of TextLogger tables
+    TableObserver* observer = nullptr;     // sink of ObserverLogger tables
+    BuiltinScopeView builtins = {};    // searched after the global scope, if set
+    BucketPolicy bucketPolicy = BucketPolicy::InsertionOrder; // not applied to tree buckets
+    int treeifyThreshold = 64;         // chain length that gets a BucketTree; 0 never
+    bool prefixIndex = false;          // keep names sorted for forEachWithPrefix
+    bool suggestIndex = false;         // keep a letter-pair index of names for forEachNear
+    ReclaimMode reclaim = ReclaimMode::Inline;
+    size_t reclaimLimit = 64 << 20;    // bytes of exited scopes that may wait to be freed
+    size_t reclaimStep = 256;          // nodes freed per operation under ReclaimMode::Amortized
+    bool smallScopes = true;           // start scopes without a bucket array, until their ninth symbol
+};
+
+// Logger is NullLogger, TextLogger or ObserverLogger (see TableLogger.hpp);
+// ScopeTable below is the TextLogger one every existing caller uses.
+template <class Logger>
+class BasicScopeTable{
+    static constexpr int SmallSize = 8;
+
+    SymbolInfo** buckets; // nullptr in small mode
     int num_buckets;
-    ScopeTable* parent_scope;
+    std::vector<unsigned long long> occupied; // bit i set <=> bucket i is non-empty; empty in small mode
+    // Small mode: most block scopes hold a handful of symbols, so a scope
+    // starts without a bucket array. It keeps the heads of its non-empty
+    // buckets in smallBuckets/smallHeads, by increasing index, and every
+    // symbol in smallSymbols next to a tag of its name (see tagOf). A lookup
+    // compares the tags of all symbols at once and reads a name only behind
+    // a matching tag, so a miss rarely touches a node. The ninth symbol
+    // moves the scope to a bucket array for good. Chains, positions and
+    // print order are the same in both modes.
+    uint32_t smallBuckets[SmallSize];
+    SymbolInfo* smallHeads[SmallSize];
+    int smallBucketCount;
+    uint32_t smallTags[SmallSize];
+    SymbolInfo* smallSymbols[SmallSize];
+    int smallCount;
+    BasicScopeTable* parent_scope;
     int id;
     double collisions;
-    static int nextId;
-    static unsigned long (*hashfunc) (const std::string&, const int);
-    static std::ostream* os;
-   
+    ScopeStats counters; // operation counters; histogram and collisions filled in on demand
+    unsigned long (*hashfunc) (const std::string&, const int);
+    BucketPolicy policy;
+    int treeifyThreshold;
+    std::vector<BucketTree*> trees; // sized on the first treeify; a tree bucket skips the policy
+    std::vector<BucketTree*> spareTrees; // emptied by clear(), for later treeifies
+    bool indexed;
+    typedef std::map<std::string_view, SymbolInfo*> NameMap;
+    NameMap sortedNames; // only if indexed; views into the nodes
+    NodeStash<NameMap> spareNames; // kept by clear()
+    bool suggesting;
+    SuggestIndex nearNames; // only if suggesting
+    // A copy-on-write copy's indexes are an overlay on base's: sortedNames
+    // and nearNames hold only the symbols of the buckets it has changed,
+    // and shadowed the names whose entry in base's indexes no longer holds
+    // here (removed, or moved to a private clone of their chain).
+    bool sharedIndexes;
+    std::unordered_set<std::string> shadowed;
+    PerfectHashIndex* frozen; // set by freeze(), dropped by the next insert or remove
+    bool silentExit;
+    unsigned long long owner; // tag of the SymbolTable that made this object, 0 if none
+    // Set on a copy-on-write copy: the scope it was copied from, which no
+    // longer changes. Buckets whose bit is clear in owned still hold base's
+    // chain; they are cloned by own() before their first change.
+    std::shared_ptr<const BasicScopeTable> base;
+    std::vector<unsigned long long> owned;
+    SymbolInfo* spare; // nodes kept by clear() for later inserts, linked through next
+    Logger logger;
+
+    // In small mode the bucket directory is the occupancy, so these do nothing.
+    void markOccupied(unsigned long index){
+        if (buckets != nullptr) occupied[index / 64] |= 1ULL << (index % 64);
+    }
+
+    void markEmpty(unsigned long index){
+        if (buckets != nullptr) occupied[index / 64] &= ~(1ULL << (index % 64));
+    }
+
+    void clearSmall(){
+        std::fill(smallBuckets, smallBuckets + SmallSize, 0);
+        std::fill(smallHeads, smallHeads + SmallSize, nullptr);
+        smallBucketCount = 0;
+        std::fill(smallTags, smallTags + SmallSize, 0);
+        std::fill(smallSymbols, smallSymbols + SmallSize, nullptr);
+        smallCount = 0;
+    }
+
+    // A hash of a name's length and its first and last eight bytes (all of
+    // a name up to 16 long), read in two loads rather than a pass over it.
+    static uint32_t tagOf(const std::string& name){
+        size_t length = name.size();
+        const char* data = name.data();
+        uint64_t head = 0, tail = 0;
+        if (length >= 8){
+            std::memcpy(&head, data, 8);
+            std::memcpy(&tail, data + length - 8, 8);
+        }
+        else if (length >= 4){
+            uint32_t first, last;
+            std::memcpy(&first, data, 4);
+            std::memcpy(&last, data + length - 4, 4);
+            head = first;
+            tail = last;
+        }
+        else if (length > 0){
+            head = (unsigned char) data[0] | (unsigned char) data[length / 2] << 8 | (unsigned char) data[length - 1] << 16;
+        }
+        uint64_t mixed = (head ^ tail * 0x9E3779B97F4A7C15ull ^ length) * 0xFF51AFD7ED558CCDull;
+        return (uint32_t) (mixed >> 32);
+    }
+
+    // Bit i set <=> keys[i] == key, for i < count.
+    static int matching(const uint32_t* keys, uint32_t key, int count){
+#ifdef __SSE2__
+        __m128i wanted = _mm_set1_epi32((int) key);
+        __m128i low = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) keys), wanted);
+        __m128i high = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (keys + 4)), wanted);
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(low)) | _mm_movemask_ps(_mm_castsi128_ps(high)) << 4;
+        return mask & ((1 << count) - 1);
+#else
+        int mask = 0;
+        for (int i = 0; i < count; i++){
+            if (keys[i] == key) mask |= 1 << i;
+        }
+        return mask;
+#endif
+    }
+
+    // Small mode: the symbol called name, or nullptr; compares gets the
+    // number of names read.
+    SymbolInfo* findSmall(const std::string& name, int* compares) const {
+        *compares = 0;
+        for (int mask = matching(smallTags, tagOf(name), smallCount); mask != 0; mask &= mask - 1){
+            SymbolInfo* symbol = smallSymbols[__builtin_ctz(mask)];
+            ++*compares;
+            if (symbol -> getName() == name) return symbol;
+        }
+        return nullptr;
+    }
+
+    // Small mode: settles a miss, and a hit that is neither logged nor
+    // moved, from the tags alone; its probes are the names read. False if
+    // the hit needs its chain.
+    bool settleSmall(const std::string& name, SymbolInfo*& found){
+        int compares = 0;
+        found = findSmall(name, &compares);
+        if (found == nullptr){
+            counters.probes.misses++;
+            counters.probes.missProbes += compares;
+            return true;
+        }
+        if (logger.active() || policy != BucketPolicy::InsertionOrder) return false;
+        counters.probes.hits++;
+        counters.probes.hitProbes += compares;
+        return true;
+    }
+
+    // Keep smallSymbols in step with the scope's symbols; adding a ninth
+    // leaves small mode.
+    void addSmall(SymbolInfo* symbol){
+        if (buckets != nullptr) return;
+        if (smallCount == SmallSize){
+            expand();
+            return;
+        }
+        smallTags[smallCount] = tagOf(symbol -> getName());
+        smallSymbols[smallCount++] = symbol;
+    }
+
+    void dropSmall(const SymbolInfo* symbol){
+        if (buckets != nullptr) return;
+        int slot = std::find(smallSymbols, smallSymbols + smallCount, symbol) - smallSymbols;
+        if (slot == smallCount) return;
+        smallCount--;
+        smallTags[slot] = smallTags[smallCount];
+        smallSymbols[slot] = smallSymbols[smallCount];
+    }
+
+    // A node cloned by own() takes its original's place.
+    void replaceSmall(const SymbolInfo* symbol, SymbolInfo* copy){
+        if (buckets != nullptr) return;
+        int slot = std::find(smallSymbols, smallSymbols + smallCount, symbol) - smallSymbols;
+        if (slot < smallCount) smallSymbols[slot] = copy;
+    }
+
+    SymbolInfo* headOf(unsigned long index) const {
+        if (buckets != nullptr) return buckets[index];
+        int mask = matching(smallBuckets, index, smallBucketCount);
+        return mask == 0 ? nullptr : smallHeads[__builtin_ctz(mask)];
+    }
+
+    // Sets a bucket's head; in small mode a bucket going empty gives up its
+    // slot, and one that finds no free slot moves the scope to a bucket array.
+    void setHead(unsigned long index, SymbolInfo* head){
+        if (buckets != nullptr){
+            buckets[index] = head;
+            return;
+        }
+        int mask = matching(smallBuckets, index, smallBucketCount);
+        int slot = mask == 0 ? -1 : __builtin_ctz(mask);
+        if (slot >= 0 && head != nullptr){
+            smallHeads[slot] = head;
+        }
+        else if (slot >= 0){
+            smallBucketCount--;
+            std::copy(smallBuckets + slot + 1, smallBuckets + smallBucketCount + 1, smallBuckets + slot);
+            std::copy(smallHeads + slot + 1, smallHeads + smallBucketCount + 1, smallHeads + slot);
+        }
+        else if (head != nullptr && smallBucketCount == SmallSize){
+            expand();
+            buckets[index] = head;
+        }
+        else if (head != nullptr){
+            for (slot = smallBucketCount++; slot > 0 && smallBuckets[slot - 1] > index; slot--){
+                smallBuckets[slot] = smallBuckets[slot - 1];
+                smallHeads[slot] = smallHeads[slot - 1];
+            }
+            smallBuckets[slot] = index;
+            smallHeads[slot] = head;
+        }
+    }
+
+    // Leaves small mode: allocates the bucket array and occupancy bitmap.
+    void expand(){
+        buckets = new SymbolInfo*[num_buckets]();
+        occupied.assign((num_buckets + 63) / 64, 0);
+        for (int slot = 0; slot < smallBucketCount; slot++){
+            buckets[smallBuckets[slot]] = smallHeads[slot];
+            markOccupied(smallBuckets[slot]);
+        }
+        clearSmall();
+        counters.allocations += 2;
+        counters.allocatedBytes += num_buckets * sizeof(SymbolInfo*) + occupied.size() * sizeof(unsigned long long);
+    }
+
+    // A spare node if clear() left any, so a refilled table reuses nodes and
+    // the capacity of their strings; a new one otherwise.
+    SymbolInfo* newSymbol(const std::string& name, const std::string& type, const SymbolAttributes& attributes){
+        if (spare == nullptr){
+            counters.allocations++;
+            counters.allocatedBytes += sizeof(SymbolInfo);
+            return new SymbolInfo(name, type, attributes);
+        }
+        SymbolInfo* symbol = spare;
+        spare = spare -> getNext();
+        symbol -> setName(name);
+        symbol -> setType(type);
+        symbol -> setAttributes(attributes);
+        symbol -> setNext(nullptr);
+        return symbol;
+    }
+
+    static void deleteChain(SymbolInfo* current){
+        while (current != nullptr){
+            SymbolInfo* next = current -> getNext();
+            delete current;
+            current = next;
+        }
+    }
+
+    bool ownsBucket(unsigned long index) const {
+        return base == nullptr || (owned[index / 64] >> (index % 64) & 1);
+    }
+
+    // base's index answers that still hold here. Not templates, so that
+    // going down a chain of copies instantiates nothing new.
+    void inheritedWithPrefix(std::string_view prefix, std::vector<SymbolInfo*>& out) const {
+        base -> forEachWithPrefix(prefix, [&](SymbolInfo* symbol){
+            if (shadowed.find(symbol -> getName()) == shadowed.end()) out.push_back(symbol);
+        });
+    }
+
+    void inheritedNear(const std::string& name, int budget, std::vector<std::pair<SymbolInfo*, int>>& out) const {
+        base -> forEachNear(name, budget, [&](SymbolInfo* symbol, int distance){
+            if (shadowed.find(symbol -> getName()) == shadowed.end()) out.push_back({symbol, distance});
+        });
+    }
+
+    void indexSymbol(SymbolInfo* symbol){
+        if (indexed) spareNames.emplace(sortedNames, symbol -> getName(), symbol);
+        if (suggesting) nearNames.insert(symbol);
+    }
+
+    void unindexSymbol(const std::string& name){
+        if (sharedIndexes) shadowed.insert(name);
+        if (indexed) sortedNames.erase(name);
+        if (suggesting) nearNames.erase(name);
+    }
+
+    // Replaces a chain shared with base by a private clone of it.
+    void own(unsigned long index){
+        SymbolInfo* head = nullptr;
+        SymbolInfo* tail = nullptr;
+        size_t length = 0;
+        for (SymbolInfo* current = headOf(index); current != nullptr; current = current -> getNext()){
+            SymbolInfo* copy = newSymbol(current -> getName(), current -> getInsertedType(), current -> getAttributes());
+            if (tail == nullptr)
+                head = copy;
+            else
+                tail -> setNext(copy);
+            tail = copy;
+            length++;
+            replaceSmall(current, copy);
+            unindexSymbol(copy -> getName());
+            indexSymbol(copy);
+        }
+        setHead(index, head);
+        owned[index / 64] |= 1ULL << (index % 64);
+        if (treeifyThreshold > 0 && length >= (size_t) treeifyThreshold) treeify(index);
+    }
+
+    // Moves a hit that is not at the head, per the bucket policy.
+    void promote(unsigned long index, SymbolInfo* current, SymbolInfo* prev, SymbolInfo* prevPrev){
+        prev -> setNext(current -> getNext());
+        if (policy == BucketPolicy::MoveToFront){
+            current -> setNext(headOf(index));
+            setHead(index, current);
+        }
+        else {
+            current -> setNext(prev);
+            if (prevPrev == nullptr)
+                setHead(index, current);
+            else
+                prevPrev -> setNext(current);
+        }
+        counters.probes.moves++;
+    }
+
+    BucketTree* treeOf(unsigned long index){
+        return trees.empty() ? nullptr : trees[index];
+    }
+
+    void treeify(unsigned long index){
+        if (trees.empty()) trees.assign(num_buckets, nullptr);
+        if (spareTrees.empty()){
+            trees[index] = new BucketTree(headOf(index));
+            return;
+        }
+        trees[index] = spareTrees.back();
+        spareTrees.pop_back();
+        trees[index] -> reset(headOf(index));
+    }
+
+    // Below half the threshold the plain chain is cheap again.
+    void untreeify(unsigned long index){
+        delete trees[index];
+        trees[index] = nullptr;
+    }
+
+    bool insertIntoTree(BucketTree* tree, unsigned long index, const std::string& name, const std::string& type,
+                        const SymbolAttributes& attributes){
+        collisions++; // as insertAt: the bucket is not empty, duplicate or not
+        if (tree -> find(name) != nullptr){
+            counters.duplicates++;
+            return false;
+        }
+        int position = tree -> size() + 1;
+        SymbolInfo* symbol = newSymbol(name, type, attributes);
+        tree -> append(symbol);
+        indexSymbol(symbol);
+        addSmall(symbol);
+        counters.inserts++;
+
+        if constexpr (Logger::enabled) {
+            logger.log({TableOp::Inserted, id, index, position, &name, parent_scope == nullptr});
+        }
+        return true;
+    }
+
+    SymbolInfo* lookupInTree(BucketTree* tree, unsigned long index, const std::string& name){
+        int position = 0;
+        SymbolInfo* found = tree -> find(name, Logger::enabled ? &position : nullptr);
+        if (found == nullptr){
+            counters.probes.misses++;
+            counters.probes.missProbes += tree -> depth();
+            return nullptr;
+        }
+        if constexpr (Logger::enabled) {
+            logger.log({TableOp::Found, id, index, position, &name, parent_scope == nullptr});
+        }
+        counters.probes.hits++;
+        counters.probes.hitProbes += tree -> depth();
+        return found;
+    }
+
+    SymbolInfo* lookupFrozen(const std::string& name){
+        unsigned long bucket = 0;
+        int position = 0;
+        SymbolInfo* found = frozen -> find(name, &bucket, &position);
+        if (found == nullptr){
+            counters.probes.misses++;
+            counters.probes.missProbes++;
+            return nullptr;
+        }
+        if constexpr (Logger::enabled) {
+            logger.log({TableOp::Found, id, bucket, position, &name, parent_scope == nullptr});
+        }
+        counters.probes.hits++;
+        counters.probes.hitProbes++;
+        return found;
+    }
+
+    SymbolInfo* detachFromTree(BucketTree* tree, unsigned long index, const std::string& name, SymbolInfo** prev, bool quiet){
+        int position = 0;
+        SymbolInfo* symbol = tree -> unlink(name, &position, prev);
+        if (symbol == nullptr){
+            if (!quiet) counters.failedRemoves++;
+            return nullptr;
+        }
+        setHead(index, tree -> getHead());
+        unindexSymbol(name);
+        dropSmall(symbol);
+        if (tree -> size() * 2 < (size_t) treeifyThreshold) untreeify(index);
+        if (headOf(index) == nullptr) markEmpty(index);
+        if (quiet) return symbol;
+
+        counters.removes++;
+        if constexpr (Logger::enabled) {
+            logger.log({TableOp::Deleted, id, index, position, &name, parent_scope == nullptr});
+        }
+        return symbol;
+    }
+
+    // See clone().
+    BasicScopeTable(const BasicScopeTable& from, BasicScopeTable* parent, const Logger& sink):
+        buckets(nullptr), num_buckets(from.num_buckets), occupied(from.occupied), parent_scope(parent), id(from.id),
+        collisions(from.collisions), counters(from.counters), hashfunc(from.hashfunc), policy(from.policy),
+        treeifyThreshold(from.treeifyThreshold), indexed(from.indexed), suggesting(from.suggesting), sharedIndexes(false),
+        frozen(nullptr), silentExit(from.silentExit), owner(0), spare(nullptr), logger(sink){
+        clearSmall();
+        if (from.buckets != nullptr) buckets = new SymbolInfo*[num_buckets]();
+        for (size_t i = from.nextOccupied(0); i < (size_t) num_buckets; i = from.nextOccupied(i + 1)){
+            SymbolInfo* tail = nullptr;
+            int length = 0;
+            for (SymbolInfo* current = from.headOf(i); current != nullptr; current = current -> getNext(), length++){
+                SymbolInfo* copy = new SymbolInfo(current -> getName(), current -> getInsertedType(), current -> getAttributes());
+                if (tail == nullptr)
+                    setHead(i, copy);
+                else
+                    tail -> setNext(copy);
+                tail = copy;
+                indexSymbol(copy);
+                addSmall(copy);
+            }
+            // a chain still shared with from's base has its tree there
+            if ((!from.trees.empty() && from.trees[i] != nullptr) || (treeifyThreshold > 0 && length >= treeifyThreshold)) treeify(i);
+        }
+        if (from.frozen != nullptr) freeze();
+    }
+
    public:
-    ScopeTable(int n, ScopeTable* parent): 
-        num_buckets(n), parent_scope(parent){
-        id = nextId++;
+    BasicScopeTable(int n, BasicScopeTable* parent, int id = 1, const ScopeConfig& config = ScopeConfig()): 
+        num_buckets(n), parent_scope(parent), id(id),
+        hashfunc(config.hashfunc), policy(config.bucketPolicy),
+        treeifyThreshold(config.treeifyThreshold), indexed(config.prefixIndex),
+        suggesting(config.suggestIndex), sharedIndexes(false), frozen(nullptr), silentExit(false), owner(0), spare(nullptr), logger(config.os, config.observer){
         collisions = 0;
-        buckets = new SymbolInfo*[num_buckets]();  
-        if(os != nullptr) {
-            *os << "\tScopeTable# " << id << " created\n";
-            os -> flush();
+        buckets = nullptr;
+        clearSmall();
+        counters.scopes = 1;
+        counters.allocations = 1;
+        counters.allocatedBytes = sizeof(BasicScopeTable);
+        if (!config.smallScopes) expand();
+        if constexpr (Logger::enabled) {
+            logger.log({TableOp::ScopeCreated, id, 0, 0, nullptr, parent_scope == nullptr});
         }
     }
 
-    ~ScopeTable(){
-        for (size_t i = 0; i < num_buckets; i++){
-            SymbolInfo* currentBucket = buckets[i];
-            while(currentBucket != nullptr){
-                SymbolInfo* next = currentBucket -> getNext();
-                delete currentBucket;
-                currentBucket = next;
-            } 
+    // Copy-on-write copy of from, for a SymbolTable that shares from with
+    // another and is about to change it. Every chain stays shared with from,
+    // which nobody may change any more, until this copy first changes it;
+    // lookups in a shared chain use from's tree or perfect hash, and skip the
+    // bucket policy. The indexes are shared the same way, as an overlay on
+    // from's (see shadowed), so a copy pays only for the buckets it changes.
+    // Logs nothing; its events go to config's sinks.
+    BasicScopeTable(std::shared_ptr<const BasicScopeTable> from, const ScopeConfig& config):
+        num_buckets(from -> num_buckets), occupied(from -> occupied), parent_scope(from -> parent_scope),
+        id(from -> id), collisions(from -> collisions), counters(from -> counters),
+        hashfunc(from -> hashfunc), policy(from -> policy), treeifyThreshold(from -> treeifyThreshold),
+        indexed(from -> indexed), suggesting(from -> suggesting),
+        sharedIndexes(from -> indexed || from -> suggesting), frozen(nullptr), silentExit(from -> silentExit), owner(0),
+        base(std::move(from)), spare(nullptr), logger(config.os, config.observer){
+        buckets = nullptr;
+        std::copy(base -> smallBuckets, base -> smallBuckets + SmallSize, smallBuckets);
+        std::copy(base -> smallHeads, base -> smallHeads + SmallSize, smallHeads);
+        smallBucketCount = base -> smallBucketCount;
+        std::copy(base -> smallTags, base -> smallTags + SmallSize, smallTags);
+        std::copy(base -> smallSymbols, base -> smallSymbols + SmallSize, smallSymbols);
+        smallCount = base -> smallCount;
+        if (base -> buckets != nullptr){
+            buckets = new SymbolInfo*[num_buckets];
+            std::copy(base -> buckets, base -> buckets + num_buckets, buckets);
+            counters.allocations++;
+            counters.allocatedBytes += num_buckets * sizeof(SymbolInfo*);
         }
+        owned.assign((num_buckets + 63) / 64, 0);
+        counters.allocations++;
+        counters.allocatedBytes += sizeof(BasicScopeTable);
+    }
+
+    // Copying is explicit, through clone().
+    BasicScopeTable(const BasicScopeTable&) = delete;
+    BasicScopeTable& operator=(const BasicScopeTable&) = delete;
+
+    // Takes over other's buckets, nodes and indexes in O(1); other is left
+    // empty and silent, fit only to be destroyed or assigned to. Scopes made
+    // with other as their parent still point at other.
+    BasicScopeTable(BasicScopeTable&& other) noexcept:
+        buckets(std::exchange(other.buckets, nullptr)), num_buckets(std::exchange(other.num_buckets, 0)),
+        occupied(std::move(other.occupied)), parent_scope(other.parent_scope), id(other.id),
+        collisions(other.collisions), counters(std::move(other.counters)), hashfunc(other.hashfunc),
+        policy(other.policy), treeifyThreshold(other.treeifyThreshold), trees(std::move(other.trees)),
+        spareTrees(std::move(other.spareTrees)), indexed(other.indexed), sortedNames(std::move(other.sortedNames)),
+        spareNames(std::move(other.spareNames)), suggesting(other.suggesting),
+        nearNames(std::move(other.nearNames)), sharedIndexes(std::exchange(other.sharedIndexes, false)),
+        shadowed(std::move(other.shadowed)),
+        frozen(std::exchange(other.frozen, nullptr)),
+        silentExit(std::exchange(other.silentExit, true)), owner(other.owner), base(std::move(other.base)),
+        owned(std::move(other.owned)), spare(std::exchange(other.spare, nullptr)), logger(other.logger){
+        std::copy(other.smallBuckets, other.smallBuckets + SmallSize, smallBuckets);
+        std::copy(other.smallHeads, other.smallHeads + SmallSize, smallHeads);
+        smallBucketCount = other.smallBucketCount;
+        std::copy(other.smallTags, other.smallTags + SmallSize, smallTags);
+        std::copy(other.smallSymbols, other.smallSymbols + SmallSize, smallSymbols);
+        smallCount = other.smallCount;
+        other.clearSmall();
+        other.occupied.clear();
+        other.trees.clear();
+        other.spareTrees.clear();
+        other.sortedNames.clear();
+        other.owned.clear();
+    }
+
+    // The scope this one held is destroyed, logging its removal as usual.
+    BasicScopeTable& operator=(BasicScopeTable&& other) noexcept {
+        BasicScopeTable taken(std::move(other));
+        swap(taken);
+        return *this;
+    }
+
+    void swap(BasicScopeTable& other) noexcept {
+        std::swap(buckets, other.buckets);
+        std::swap(num_buckets, other.num_buckets);
+        occupied.swap(other.occupied);
+        std::swap(smallBuckets, other.smallBuckets);
+        std::swap(smallHeads, other.smallHeads);
+        std::swap(smallBucketCount, other.smallBucketCount);
+        std::swap(smallTags, other.smallTags);
+        std::swap(smallSymbols, other.smallSymbols);
+        std::swap(smallCount, other.smallCount);
+        std::swap(parent_scope, other.parent_scope);
+        std::swap(id, other.id);
+        std::swap(collisions, other.collisions);
+        std::swap(counters, other.counters);
+        std::swap(hashfunc, other.hashfunc);
+        std::swap(policy, other.policy);
+        std::swap(treeifyThreshold, other.treeifyThreshold);
+        trees.swap(other.trees);
+        spareTrees.swap(other.spareTrees);
+        std::swap(indexed, other.indexed);
+        sortedNames.swap(other.sortedNames);
+        spareNames.swap(other.spareNames);
+        std::swap(suggesting, other.suggesting);
+        std::swap(nearNames, other.nearNames);
+        std::swap(sharedIndexes, other.sharedIndexes);
+        shadowed.swap(other.shadowed);
+        std::swap(frozen, other.frozen);
+        std::swap(silentExit, other.silentExit);
+        std::swap(owner, other.owner);
+        base.swap(other.base);
+        owned.swap(other.owned);
+        std::swap(spare, other.spare);
+        std::swap(logger, other.logger);
+    }
+
+    // A deep copy: every chain is copied in order, with the same trees,
+    // indexes and frozen state, sharing nothing with this scope. It has the
+    // same id and parent and logs to the same sinks; nothing is logged.
+    BasicScopeTable clone() const {
+        return BasicScopeTable(*this, parent_scope, logger);
+    }
+
+    // Same, under another parent and logging to config's sinks.
+    BasicScopeTable clone(BasicScopeTable* parent, const ScopeConfig& config) const {
+        return BasicScopeTable(*this, parent, Logger(config.os, config.observer));
+    }
+
+    ~BasicScopeTable(){
+        for (size_t i = nextOccupied(0); i < (size_t) num_buckets; i = nextOccupied(i + 1)){
+            if (ownsBucket(i)) deleteChain(headOf(i));
+        }
+        deleteChain(spare);
 
         delete [] buckets;
+        delete frozen;
+        for (BucketTree* tree : trees){
+            delete tree;
+        }
+        for (BucketTree* tree : spareTrees){
+            delete tree;
+        }
 
-        if(os != nullptr) {
-            if (parent_scope == nullptr) {
-                *os << "\tScopeTable# " << id << " removed"; // No newline for global scope
-            } else {
-                *os << "\tScopeTable# " << id << " removed\n"; // Newline for others
-            }
-            os -> flush();
+        if constexpr (Logger::enabled) {
+            if (!silentExit) logger.log({TableOp::ScopeRemoved, id, 0, 0, nullptr, parent_scope == nullptr});
         }
     }
 
     int getId() { return id; }
-    ScopeTable* getParent() { return parent_scope; }
+    BasicScopeTable* getParent() { return parent_scope; }
+    int getNumBuckets() { return num_buckets; }
+    SymbolInfo* getBucket(int index) { return headOf(index); }
+
+    // True until the scope first holds more than SmallSize symbols (see
+    // ScopeConfig::smallScopes).
+    bool isSmall() const { return buckets == nullptr; }
+
+    void setOutputStream(std::ostream* outputStream){
+        logger.setOutputStream(outputStream);
+    }
+
+    unsigned long long getOwner() const { return owner; }
+    void setOwner(unsigned long long tag){
+        owner = tag;
+    }
+
+    static constexpr unsigned long Unhashed = ~0UL; // see lookupHashing
 
-    static void setHashFunction(unsigned long (*func) (const std::string&, const int)){
-        hashfunc = func;
+    unsigned long bucketOf(const std::string& name){
+        return hashfunc(name, num_buckets) % num_buckets;
     }
 
-    static void setNextId(){
-        nextId = 1;
+    // Batched callers hint the slot first, then the head node once every
+    // slot request is in flight, so the cache misses of a batch overlap. A
+    // small scope's lookups start at its tags.
+    void prefetchBucket(unsigned long index){
+        if (buckets == nullptr)
+            __builtin_prefetch(smallTags);
+        else if (index != Unhashed)
+            __builtin_prefetch(&buckets[index]);
     }
 
-    static void setOutputStream(std::ostream* outputStream){
-        os = outputStream;
+    void prefetchHead(unsigned long index){
+        if (SymbolInfo* head = headOf(index)) __builtin_prefetch(head);
     }
 
     bool insert(const std::string& name, const std::string& type){
-        unsigned long index = hashfunc(name, num_buckets) % num_buckets;
-        SymbolInfo* current = buckets[index];
+        return insertAt(bucketOf(name), name, type);
+    }
+
+    // A symbol whose type is given by its attributes rather than by text.
+    bool insert(const std::string& name, const SymbolAttributes& attributes){
+        return insertAt(bucketOf(name), name, std::string(), attributes);
+    }
+
+    // Same as insert, for a caller that already knows the bucket.
+    bool insertAt(unsigned long index, const std::string& name, const std::string& type,
+                  const SymbolAttributes& attributes = SymbolAttributes()){
+        if (frozen != nullptr){
+            if (frozen -> find(name) != nullptr){
+                collisions++; // the name's bucket is not empty
+                counters.duplicates++;
+                return false;
+            }
+            thaw();
+        }
+        if (!ownsBucket(index)){
+            int position = 0;
+            if (headOf(index) != nullptr && findAt(index, name, &position) != nullptr){
+                collisions++;
+                counters.duplicates++;
+                return false;
+            }
+            own(index);
+        }
+        if (BucketTree* tree = treeOf(index)) return insertIntoTree(tree, index, name, type, attributes);
+
+        SymbolInfo* current = headOf(index);
         SymbolInfo* prev = nullptr;
         int position = 1;
 
@@ -75,89 +735,577 @@ class ScopeTable{
         }
         
         while (current != nullptr){
-            if (current -> getName() == name) return false; // already exists
+            if (current -> getName() == name){
+                counters.duplicates++;
+                return false; // already exists
+            }
                 
             prev = current;
             current = current -> getNext();
             position++;
         }
         
-        SymbolInfo* newSymbol = new SymbolInfo(name, type);
-        if (prev == nullptr)
-            buckets[index] = newSymbol;
+        SymbolInfo* symbol = newSymbol(name, type, attributes);
+        counters.inserts++;
+        if (prev == nullptr){
+            setHead(index, symbol);
+            markOccupied(index);
+        }
         else 
-            prev -> setNext(newSymbol);
+            prev -> setNext(symbol);
+        indexSymbol(symbol);
+        addSmall(symbol);
+        if (treeifyThreshold > 0 && position >= treeifyThreshold) treeify(index);
 
-        if(os != nullptr){
-            *os << "\tInserted in ScopeTable# " << id << " at position "<<(index+1)<<", "<<position<<"\n"; 
-            //os -> flush();
-        } 
+        if constexpr (Logger::enabled) {
+            logger.log({TableOp::Inserted, id, index, position, &name, parent_scope == nullptr});
+        }
         return true;
     }
 
     SymbolInfo* lookup(const std::string& name){
-        unsigned long index = hashfunc(name, num_buckets) % num_buckets;
-        SymbolInfo* current = buckets[index];
+        unsigned long index = Unhashed;
+        return lookupHashing(index, name);
+    }
+
+    // Whether lookupHashing can answer without the name's bucket.
+    bool settlesUnhashed() const {
+        return frozen != nullptr || (buckets == nullptr && base == nullptr && trees.empty());
+    }
+
+    // lookupAt for a caller that may not have hashed the name yet (index is
+    // Unhashed): a frozen scope answers from its perfect hash and a small
+    // scope settles most lookups from its tags, both without the bucket
+    // hash. Otherwise index is set to the name's bucket, for the caller's
+    // next scope.
+    SymbolInfo* lookupHashing(unsigned long& index, const std::string& name){
+        if (frozen != nullptr) return lookupFrozen(name);
+        if (index == Unhashed){
+            SymbolInfo* found = nullptr;
+            if (settlesUnhashed() && settleSmall(name, found)) return found;
+            index = bucketOf(name);
+        }
+        return lookupAt(index, name);
+    }
+
+    SymbolInfo* lookupAt(unsigned long index, const std::string& name){
+        if (frozen != nullptr) return lookupFrozen(name);
+        if (!ownsBucket(index)){
+            int position = 0;
+            SymbolInfo* found = findAt(index, name, &position);
+            if (found == nullptr){
+                counters.probes.misses++;
+                counters.probes.missProbes += position;
+                return nullptr;
+            }
+            if constexpr (Logger::enabled) {
+                logger.log({TableOp::Found, id, index, position, &name, parent_scope == nullptr});
+            }
+            counters.probes.hits++;
+            counters.probes.hitProbes += position;
+            return found;
+        }
+        if (BucketTree* tree = treeOf(index)) return lookupInTree(tree, index, name);
+        SymbolInfo* found = nullptr;
+        if (buckets == nullptr && settleSmall(name, found)) return found;
+
+        SymbolInfo* current = headOf(index);
+        SymbolInfo* prev = nullptr;
+        SymbolInfo* prevPrev = nullptr;
         int position = 1;
 
         while (current != nullptr){
             if (current -> getName() == name){
 
-                if(os != nullptr) {
-                    *os <<"\t'"<<name<<"'"<<" found in ScopeTable# "<< id << " at position "<<(index+1)<<", "<< position<<"\n";
-                    //os -> flush();
+                if constexpr (Logger::enabled) {
+                    logger.log({TableOp::Found, id, index, position, &name, parent_scope == nullptr});
+                }
+                counters.probes.hits++;
+                counters.probes.hitProbes += position;
+                if (prev != nullptr && policy != BucketPolicy::InsertionOrder){
+                    promote(index, current, prev, prevPrev);
                 }
                 return current;
             }
+            prevPrev = prev;
+            prev = current;
             current = current -> getNext();
             position++;
         }
+        counters.probes.misses++;
+        counters.probes.missProbes += position - 1;
+        return nullptr;
+    }
+
+    // lookupAt without side effects: nothing is logged or counted and no
+    // chain is reordered, so tables sharing this scope may call it from
+    // several threads. position gets the 1-based place of a hit, or the
+    // number of names compared on a miss.
+    SymbolInfo* findAt(unsigned long index, const std::string& name, int* position) const {
+        if (frozen != nullptr){
+            unsigned long bucket = 0;
+            *position = 1;
+            return frozen -> find(name, &bucket, position);
+        }
+        if (!ownsBucket(index)) return base -> findAt(index, name, position);
+        if (!trees.empty() && trees[index] != nullptr){
+            *position = trees[index] -> depth();
+            return trees[index] -> find(name, position);
+        }
+        if (buckets == nullptr && findSmall(name, position) == nullptr) return nullptr;
+        int count = 0;
+        for (SymbolInfo* current = headOf(index); current != nullptr; current = current -> getNext()){
+            count++;
+            if (current -> getName() == name){
+                *position = count;
+                return current;
+            }
+        }
+        *position = count;
         return nullptr;
     }
 
+    // Equivalent to calling insert on each pair in order (a name repeated in
+    // the batch fails the second time), log lines included.
+    std::vector<bool> insertMany(const std::vector<std::pair<std::string, std::string>>& symbols){
+        std::vector<unsigned long> indexes(symbols.size());
+        for (size_t i = 0; i < symbols.size(); i++){
+            indexes[i] = bucketOf(symbols[i].first);
+            prefetchBucket(indexes[i]);
+        }
+        for (size_t i = 0; i < symbols.size(); i++){
+            prefetchHead(indexes[i]);
+        }
+
+        std::vector<bool> inserted(symbols.size());
+        for (size_t i = 0; i < symbols.size(); i++){
+            inserted[i] = insertAt(indexes[i], symbols[i].first, symbols[i].second);
+        }
+        return inserted;
+    }
+
+    // Equivalent to calling lookup on each name in order.
+    std::vector<SymbolInfo*> lookupMany(const std::vector<std::string>& names){
+        std::vector<unsigned long> indexes(names.size());
+        for (size_t i = 0; i < names.size(); i++){
+            indexes[i] = bucketOf(names[i]);
+            prefetchBucket(indexes[i]);
+        }
+        for (size_t i = 0; i < names.size(); i++){
+            prefetchHead(indexes[i]);
+        }
+
+        std::vector<SymbolInfo*> found(names.size());
+        for (size_t i = 0; i < names.size(); i++){
+            found[i] = lookupAt(indexes[i], names[i]);
+        }
+        return found;
+    }
+
     bool remove(const std::string& name){
-        unsigned long index = hashfunc(name, num_buckets) % num_buckets;
-        SymbolInfo* current = buckets[index];
-        SymbolInfo* prev = nullptr;
+        SymbolInfo* symbol = detach(name);
+        delete symbol;
+        return symbol != nullptr;
+    }
+
+    // remove without freeing the node: it is unlinked, logged and counted
+    // the same way and handed back, nullptr if absent. prev, if asked for,
+    // gets the node it followed in its chain (nullptr at the head), which is
+    // what reattach needs to put it back. A quiet detach logs and counts
+    // nothing, for undoing an insert.
+    SymbolInfo* detach(const std::string& name, SymbolInfo** prev = nullptr, bool quiet = false){
+        unsigned long index = bucketOf(name);
+        if (frozen != nullptr){
+            if (frozen -> find(name) == nullptr){
+                if (!quiet) counters.failedRemoves++;
+                return nullptr;
+            }
+            thaw();
+        }
+        if (!ownsBucket(index)){
+            int position = 0;
+            if (findAt(index, name, &position) == nullptr){
+                if (!quiet) counters.failedRemoves++;
+                return nullptr;
+            }
+            own(index);
+        }
+        if (BucketTree* tree = treeOf(index)) return detachFromTree(tree, index, name, prev, quiet);
+
+        SymbolInfo* current = headOf(index);
+        SymbolInfo* before = nullptr;
         int position = 1;
 
         while (current != nullptr){
             if (current -> getName() == name){
-                if (prev == nullptr)
-                    buckets[index] = current -> getNext();
+                if (before == nullptr)
+                    setHead(index, current -> getNext());
                 else
-                    prev -> setNext(current -> getNext());
+                    before -> setNext(current -> getNext());
+                current -> setNext(nullptr);
+                if (headOf(index) == nullptr) markEmpty(index);
+                unindexSymbol(name);
+                dropSmall(current);
+                if (prev != nullptr) *prev = before;
+                if (quiet) return current;
 
-                delete current;
-
-                if(os != nullptr) {
-                    *os<<"\tDeleted "<<"'"<<name<<"'"<<" from ScopeTable# "<< id <<" at position "<<(index+1)<<", "<<position<<"\n";
-                    //os -> flush();
+                counters.removes++;
+                if constexpr (Logger::enabled) {
+                    logger.log({TableOp::Deleted, id, index, position, &name, parent_scope == nullptr});
                 }
-                return true;
+                return current;
             }
-            prev = current;
+            before = current;
             current = current -> getNext();
             position++;
         }
-        return false; //symbol not found
+        if (!quiet) counters.failedRemoves++;
+        return nullptr; //symbol not found
     }
 
-    void print(const std::string& indent = "") {
-        if (os != nullptr) {
-            *os << indent << "ScopeTable# " << id << "\n";
+    // Links a detached symbol back in right after prev, which must still be
+    // in the symbol's chain (nullptr for the head). If this is a copy made
+    // since the detach, prev is the node of the scope it was copied from and
+    // is looked up here by name. Nothing is logged.
+    void reattach(SymbolInfo* symbol, SymbolInfo* prev, bool copiedSince = false){
+        thaw();
+        unsigned long index = bucketOf(symbol -> getName());
+        if (!ownsBucket(index)) own(index);
+        if (copiedSince && prev != nullptr){
+            int position = 0;
+            prev = findAt(index, prev -> getName(), &position);
+        }
+        if (BucketTree* tree = treeOf(index)){
+            tree -> insertAfter(symbol, prev);
+            setHead(index, tree -> getHead());
+        }
+        else if (prev == nullptr){
+            symbol -> setNext(headOf(index));
+            setHead(index, symbol);
+        }
+        else {
+            symbol -> setNext(prev -> getNext());
+            prev -> setNext(symbol);
+        }
+        markOccupied(index);
+        indexSymbol(symbol);
+        addSmall(symbol);
+    }
+
+    // A scope kept alive after exitScope (for a rollback) has already logged
+    // its removal, so its destructor must not log it again.
+    void setSilentExit(bool silent){
+        silentExit = silent;
+    }
+
+    // Empties the scope for reuse: symbols, indexes and counters go, but the
+    // bucket array stays, and the nodes, bucket trees and index nodes are
+    // kept as spares for later inserts, so refilling it to the same size
+    // allocates nothing. Logs nothing.
+    void clear(){
+        thaw();
+        for (BucketTree*& tree : trees){
+            if (tree == nullptr) continue;
+            tree -> reset(nullptr);
+            spareTrees.push_back(tree);
+            tree = nullptr;
+        }
+        for (size_t i = nextOccupied(0); i < (size_t) num_buckets; i = nextOccupied(i + 1)){
+            if (ownsBucket(i)){
+                SymbolInfo* tail = headOf(i);
+                while (tail -> getNext() != nullptr) tail = tail -> getNext();
+                tail -> setNext(spare);
+                spare = headOf(i);
+            }
+            setHead(i, nullptr);
         }
-        for (size_t i = 0; i < num_buckets; i++) {
-            if (os != nullptr) {
-                *os << indent << (i+1) << "--> ";
+        std::fill(occupied.begin(), occupied.end(), 0);
+        smallCount = 0;
+        sharedIndexes = false;
+        shadowed.clear();
+        base.reset();
+        spareNames.takeAll(sortedNames);
+        nearNames.clear();
+        collisions = 0;
+        counters = ScopeStats();
+        counters.scopes = 1;
+    }
+
+    // clear(), then stands in for a newly made scope with this parent and
+    // id, logging its creation as the constructor does.
+    void reopen(BasicScopeTable* parent, int newId){
+        clear();
+        parent_scope = parent;
+        id = newId;
+        if constexpr (Logger::enabled) {
+            logger.log({TableOp::ScopeCreated, id, 0, 0, nullptr, parent_scope == nullptr});
+        }
+    }
+
+    // For a scope on its way out (see ScopeReclaimer): frees about budget
+    // of its nodes, index entries and tree entries (a bucket tree goes in
+    // one piece), so a large scope can be torn down in steps rather than by
+    // one destructor call. The length of
+    // each chain it finishes is added to chains; carried keeps the count of
+    // a chain left part way between calls. Returns how much was freed, which
+    // is less than budget only once the bucket array is all that is left. Logs nothing, and the
+    // scope is good for nothing but destruction after the first call.
+    size_t shed(size_t budget, ProbeStats& chains, size_t& carried){
+        size_t freed = 0;
+        thaw();
+        smallCount = 0;
+        sharedIndexes = false; // nothing of base's to free
+        shadowed.clear();
+        while (freed < budget && !sortedNames.empty()){
+            sortedNames.erase(sortedNames.begin());
+            freed++;
+        }
+        if (freed < budget && nearNames.size() > 0){
+            freed += nearNames.size();
+            nearNames = SuggestIndex();
+        }
+        for (size_t i = nextOccupied(0); freed < budget && i < (size_t) num_buckets; i = nextOccupied(i)){
+            if (treeOf(i) != nullptr){
+                freed += trees[i] -> size();
+                untreeify(i);
+                continue;
+            }
+            bool mine = ownsBucket(i); // otherwise only counted
+            SymbolInfo* head = headOf(i);
+            while (freed < budget && head != nullptr){
+                SymbolInfo* next = head -> getNext();
+                if (mine) delete head;
+                head = next;
+                carried++;
+                freed++;
+            }
+            setHead(i, head);
+            if (head != nullptr) break;
+            chains.addChain(carried);
+            carried = 0;
+            markEmpty(i);
+        }
+        while (freed < budget && spare != nullptr){
+            SymbolInfo* next = spare -> getNext();
+            delete spare;
+            spare = next;
+            freed++;
+        }
+        freed += spareNames.drop(budget - std::min(freed, budget));
+        while (freed < budget && !spareTrees.empty()){
+            freed += spareTrees.back() -> capacity();
+            delete spareTrees.back();
+            spareTrees.pop_back();
+        }
+        return freed;
+    }
+
+    // The scope a copy-on-write copy was made from, handed over once shed()
+    // has emptied this one, so the caller decides when it is freed.
+    std::shared_ptr<const BasicScopeTable> takeBase(){
+        return std::move(base);
+    }
+
+    // First non-empty bucket at or after 'from', or num_buckets if none.
+    size_t nextOccupied(size_t from) const {
+        if (from >= (size_t) num_buckets) return num_buckets;
+        if (buckets == nullptr){
+            for (int slot = 0; slot < smallBucketCount; slot++){
+                if (smallBuckets[slot] >= from) return smallBuckets[slot];
+            }
+            return num_buckets;
+        }
+        size_t word = from / 64;
+        unsigned long long bits = occupied[word] & (~0ULL << (from % 64));
+        while (bits == 0){
+            if (++word == occupied.size()) return num_buckets;
+            bits = occupied[word];
+        }
+        return word * 64 + __builtin_ctzll(bits);
+    }
+
+    // Visits every symbol in print order: bucket by bucket, then chain order.
+    // visit(symbol, bucket index, position in chain); empty buckets are skipped
+    // through the occupancy bitmap without being touched.
+    template <class Visitor>
+    void forEach(Visitor visit) const {
+        for (size_t i = nextOccupied(0); i < (size_t) num_buckets; i = nextOccupied(i + 1)){
+            int position = 1;
+            for (SymbolInfo* current = headOf(i); current != nullptr; current = current -> getNext()){
+                visit(current, i, position++);
+            }
+        }
+    }
+
+    // For a scope that is now read far more than written, typically the
+    // global scope once it is populated: adds a minimal perfect hash over
+    // its names, so a lookup costs one probe and one compare. The chains
+    // stay as they are (symbols do not move and print is unchanged), and
+    // the bucket policy is not applied while frozen. The next successful
+    // insert or remove thaws the scope. False, and still thawed, in the
+    // unlikely case that no perfect hash was found.
+    bool freeze(){
+        thaw();
+        frozen = new PerfectHashIndex();
+        if (!frozen -> build([&](auto visit){ forEach(visit); })){
+            thaw();
+            return false;
+        }
+        return true;
+    }
+
+    void thaw(){
+        delete frozen;
+        frozen = nullptr;
+    }
+
+    bool isFrozen() const { return frozen != nullptr; }
+
+    bool hasPrefixIndex() const { return indexed; }
+
+    // Visits the symbols whose names start with prefix, in name order when
+    // the scope keeps a prefix index (time proportional to the matches),
+    // otherwise in print order after a scan of every bucket.
+    template <class Visitor>
+    void forEachWithPrefix(std::string_view prefix, Visitor visit) const {
+        if (indexed && sharedIndexes){
+            // base's matches still in force, merged with this copy's own
+            std::vector<SymbolInfo*> inherited;
+            inheritedWithPrefix(prefix, inherited);
+            auto next = inherited.begin();
+            for (auto it = sortedNames.lower_bound(prefix); it != sortedNames.end(); ++it){
+                if (it -> first.substr(0, prefix.size()) != prefix) break;
+                for (; next != inherited.end() && (*next) -> getName() < it -> first; ++next){
+                    visit(*next);
+                }
+                visit(it -> second);
+            }
+            for (; next != inherited.end(); ++next){
+                visit(*next);
+            }
+            return;
+        }
+        if (indexed){
+            for (auto it = sortedNames.lower_bound(prefix); it != sortedNames.end(); ++it){
+                if (it -> first.substr(0, prefix.size()) != prefix) break;
+                visit(it -> second);
             }
-            SymbolInfo* current = buckets[i];
-            while (current != nullptr) {
-                *os << "<" << current->getName() << "," << current->getType() << "> ";
-                current = current->getNext();
+            return;
+        }
+        forEach([&](SymbolInfo* symbol, size_t, int){
+            if (std::string_view(symbol -> getName()).substr(0, prefix.size()) == prefix) visit(symbol);
+        });
+    }
+
+    bool hasSuggestIndex() const { return suggesting; }
+
+    // visit(symbol, distance) for every symbol within budget edits of name,
+    // in no particular order; through the letter-pair index if the scope
+    // keeps one, otherwise by measuring every name.
+    template <class Visitor>
+    void forEachNear(const std::string& name, int budget, Visitor visit) const {
+        if (suggesting && sharedIndexes){
+            std::vector<std::pair<SymbolInfo*, int>> inherited;
+            inheritedNear(name, budget, inherited);
+            for (const auto& [symbol, distance] : inherited){
+                visit(symbol, distance);
             }
-            *os << "\n";
         }
+        if (suggesting){
+            nearNames.forEachNear(name, budget, visit);
+            return;
+        }
+        forEach([&](SymbolInfo* symbol, size_t, int){
+            int distance = editDistance(name, symbol -> getName(), budget);
+            if (distance <= budget) visit(symbol, distance);
+        });
+    }
+
+    // Writes to the logger's stream; a NullLogger or ObserverLogger table has none.
+    void print(const std::string& indent = "") {
+        if (logger.stream() != nullptr) print(*logger.stream(), indent);
+    }
+
+    void print(std::ostream& os, const std::string& indent) const {
+        os << indent << "ScopeTable# " << id << "\n";
+        size_t i = 0;
+        for (size_t next = nextOccupied(0); i < (size_t) num_buckets; next = nextOccupied(i)) {
+            for (; i < next; i++) {
+                os << indent << (i+1) << "--> \n";
+            }
+            if (i == (size_t) num_buckets) break;
+
+            os << indent << (i+1) << "--> ";
+            for (SymbolInfo* current = headOf(i); current != nullptr; current = current->getNext()) {
+                os << "<" << current->getName() << ",";
+                current->printType(os);
+                os << "> ";
+            }
+            os << "\n";
+            i++;
+        }
+    }
+
+    MemoryStats memoryStats(){
+        MemoryStats stats;
+        stats.scopes = 1;
+        stats.tableBytes = sizeof(BasicScopeTable);
+        stats.buckets = num_buckets;
+        if (buckets != nullptr) stats.bucketBytes = num_buckets * sizeof(SymbolInfo*) + occupied.size() * sizeof(unsigned long long);
+        forEach([&](SymbolInfo* symbol, size_t bucket, int){
+            stats.symbols++;
+            if (!ownsBucket(bucket)) return; // counted by the scope it is shared from
+            stats.nodeBytes += sizeof(SymbolInfo);
+            stats.addString(symbol -> getName());
+            stats.addString(symbol -> getInsertedType());
+        });
+        for (SymbolInfo* symbol = spare; symbol != nullptr; symbol = symbol -> getNext()){
+            stats.nodeBytes += sizeof(SymbolInfo);
+            stats.addString(symbol -> getName());
+            stats.addString(symbol -> getInsertedType());
+        }
+        for (BucketTree* tree : trees){
+            if (tree != nullptr) stats.indexBytes += tree -> bytes();
+        }
+        for (BucketTree* tree : spareTrees){
+            stats.indexBytes += tree -> bytes();
+        }
+        // a red-black node: three links, a colour word and the pair
+        stats.indexBytes += (sortedNames.size() + spareNames.size()) * (4 * sizeof(void*) + sizeof(std::pair<std::string_view, SymbolInfo*>));
+        if (suggesting) stats.indexBytes += nearNames.bytes();
+        for (const std::string& name : shadowed){
+            stats.indexBytes += 2 * sizeof(void*) + sizeof(std::string);
+            stats.addString(name);
+        }
+        if (frozen != nullptr) stats.indexBytes += frozen -> bytes();
+        return stats;
+    }
+
+    ProbeStats probeStats(){
+        ProbeStats stats = counters.probes;
+        for (size_t i = 0; i < (size_t) num_buckets; i++){
+            size_t length = 0;
+            for (SymbolInfo* current = headOf(i); current != nullptr; current = current -> getNext()){
+                length++;
+            }
+            stats.addChain(length);
+        }
+        return stats;
+    }
+
+    ScopeStats stats(){
+        ScopeStats result = statsWithoutChains();
+        result.probes = probeStats();
+        return result;
+    }
+
+    // stats() without the chain-length histogram, which takes a walk of
+    // every chain.
+    ScopeStats statsWithoutChains() const {
+        ScopeStats result = counters;
+        result.buckets = num_buckets;
+        result.collisions = collisions;
+        return result;
     }
 
     double getCollisionsRato(){
@@ -166,10 +1314,7 @@ class ScopeTable{
 
 };
 
+using ScopeTable = BasicScopeTable<TextLogger>;
 
-int ScopeTable::nextId = 1;
-// This will be used to set the hashfunction from symbol table 
-unsigned long (*ScopeTable::hashfunc)(const std::string&, const int) = SDBMHash;
-std::ostream* ScopeTable::os = nullptr;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,151 @@
+#ifndef SHARDEDSCOPETABLE_H
+#define SHARDEDSCOPETABLE_H
+
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include "SymbolInfo.hpp"
+#include "Hashfunctions.hpp"
+
+// Global scope that several threads can insert into at once. Buckets are
+// split into shards (bucket index % num_shards) and every shard has its own
+// lock, so writers only contend when their names land in the same shard.
+// A name always maps to one shard, which keeps duplicate detection exact.
+//
+// A symbol may be removed by another thread at any time, so lookup hands
+// it to a visitor while the shard is still locked instead of returning a
+// pointer to it.
+class ShardedScopeTable{
+    struct alignas(64) Shard{
+        mutable std::shared_mutex lock;
+        double collisions = 0;
+    };
+
+    SymbolInfo** buckets;
+    int num_buckets;
+    int num_shards;
+    Shard* shards;
+    unsigned long (*hashfunc) (const std::string&, const int);
+
+    unsigned long indexOf(const std::string& name) const {
+        return hashfunc(name, num_buckets) % num_buckets;
+    }
+
+    Shard& shardOf(unsigned long index) const {
+        return shards[index % num_shards];
+    }
+
+   public:
+    ShardedScopeTable(int n, int numShards, unsigned long (*func) (const std::string&, const int) = SDBMHash)
+    : num_buckets(n), num_shards(numShards < 1 ? 1 : numShards), hashfunc(func){
+        if (num_shards > num_buckets) num_shards = num_buckets;
+        buckets = new SymbolInfo*[num_buckets]();
+        shards = new Shard[num_shards];
+    }
+
+    ~ShardedScopeTable(){
+        for (int i = 0; i < num_buckets; i++){
+            SymbolInfo* current = buckets[i];
+            while (current != nullptr){
+                SymbolInfo* next = current -> getNext();
+                delete current;
+                current = next;
+            }
+        }
+        delete [] buckets;
+        delete [] shards;
+    }
+
+    ShardedScopeTable(const ShardedScopeTable&) = delete;
+    ShardedScopeTable& operator=(const ShardedScopeTable&) = delete;
+
+    int getNumShards() const { return num_shards; }
+
+    bool insert(const std::string& name, const std::string& type){
+        unsigned long index = indexOf(name);
+        Shard& shard = shardOf(index);
+        // build the node before taking the lock to keep the critical section short
+        SymbolInfo* newSymbol = new SymbolInfo(name, type);
+
+        std::unique_lock<std::shared_mutex> guard(shard.lock);
+        SymbolInfo* current = buckets[index];
+        SymbolInfo* prev = nullptr;
+
+        if (current != nullptr){
+            shard.collisions++;
+        }
+
+        while (current != nullptr){
+            if (current -> getName() == name){
+                guard.unlock();
+                delete newSymbol;
+                return false; // already exists
+            }
+            prev = current;
+            current = current -> getNext();
+        }
+
+        if (prev == nullptr)
+            buckets[index] = newSymbol;
+        else
+            prev -> setNext(newSymbol);
+        return true;
+    }
+
+    // Calls visit(const SymbolInfo&) on the symbol named name, under the
+    // shard's shared lock; visit must not keep the reference or call back
+    // into this table. False, and visit not called, if there is none.
+    template <class Visitor>
+    bool lookup(const std::string& name, Visitor visit) const {
+        unsigned long index = indexOf(name);
+        std::shared_lock<std::shared_mutex> guard(shardOf(index).lock);
+
+        for (const SymbolInfo* current = buckets[index]; current != nullptr; current = current -> getNext()){
+            if (current -> getName() == name){
+                visit(*current);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool contains(const std::string& name) const {
+        return lookup(name, [](const SymbolInfo&){});
+    }
+
+    bool remove(const std::string& name){
+        unsigned long index = indexOf(name);
+        SymbolInfo* found = nullptr;
+        {
+            std::unique_lock<std::shared_mutex> guard(shardOf(index).lock);
+            SymbolInfo* current = buckets[index];
+            SymbolInfo* prev = nullptr;
+
+            while (current != nullptr){
+                if (current -> getName() == name){
+                    if (prev == nullptr)
+                        buckets[index] = current -> getNext();
+                    else
+                        prev -> setNext(current -> getNext());
+                    found = current;
+                    break;
+                }
+                prev = current;
+                current = current -> getNext();
+            }
+        }
+        delete found;
+        return found != nullptr;
+    }
+
+    double getCollisionsRato() const {
+        double collisions = 0;
+        for (int i = 0; i < num_shards; i++){
+            std::shared_lock<std::shared_mutex> guard(shards[i].lock);
+            collisions += shards[i].collisions;
+        }
+        return collisions / (num_buckets*1.0);
+    }
+};
+
+#endif
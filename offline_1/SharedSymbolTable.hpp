@@ -0,0 +1,144 @@
+#ifndef SHAREDSYMBOLTABLE_H
+#define SHAREDSYMBOLTABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SymbolSnapshot.hpp"
+
+// A symbol table in a POSIX shared-memory segment. One process fills an
+// ordinary SymbolTable and publishes it; any number of other processes
+// attach read-only and look names up in place. The segment holds a snapshot
+// image (see SymbolSnapshot.hpp) behind a small header carrying the
+// publisher's version stamp, so a reader expecting another version, or a
+// segment still being written, is turned away.
+//
+// Segment names follow shm_open rules: a leading '/' and no other slashes.
+
+const char SHARED_MAGIC[8] = {'S', 'Y', 'M', 'S', 'H', 'M', '0', '1'};
+
+struct SharedSegmentHeader{
+    char magic[8];
+    std::atomic<uint32_t> ready; // set last, with release order
+    uint32_t reserved;
+    uint64_t version;
+    uint64_t imageSize;
+    char padding[32];            // keeps the image 64-byte aligned
+};
+
+class SharedSymbolTable{
+    void* segment;
+    size_t segmentSize;
+    SnapshotView view;
+    ScopeConfig config;
+
+    void detach(){
+        if (segment != nullptr) munmap(segment, segmentSize);
+        segment = nullptr;
+        segmentSize = 0;
+        view.close();
+    }
+
+   public:
+    SharedSymbolTable(const ScopeConfig& cfg = ScopeConfig()) : segment(nullptr), segmentSize(0), config(cfg) {}
+
+    ~SharedSymbolTable(){
+        detach();
+    }
+
+    SharedSymbolTable(const SharedSymbolTable&) = delete;
+    SharedSymbolTable& operator=(const SharedSymbolTable&) = delete;
+
+    // Replaces any segment of that name. Processes still attached to the old
+    // one keep their mapping until they detach.
+    template <class Logger>
+    static bool publish(BasicSymbolTable<Logger>& st, const std::string& name, uint64_t version){
+        std::vector<char> image = writeSnapshotImage(st);
+        if (image.empty()) return false;
+        size_t size = sizeof(SharedSegmentHeader) + image.size();
+
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) return false;
+        if (ftruncate(fd, size) != 0){
+            close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+        void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED){
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        SharedSegmentHeader* header = new (mapped) SharedSegmentHeader();
+        std::memcpy(header -> magic, SHARED_MAGIC, sizeof(header -> magic));
+        header -> version = version;
+        header -> imageSize = image.size();
+        std::memcpy(static_cast<char*>(mapped) + sizeof(SharedSegmentHeader), image.data(), image.size());
+        header -> ready.store(1, std::memory_order_release);
+
+        munmap(mapped, size);
+        return true;
+    }
+
+    static bool unpublish(const std::string& name){
+        return shm_unlink(name.c_str()) == 0;
+    }
+
+    // Fails if the segment is missing, unfinished, stamped with another
+    // version or built with a different hash function.
+    bool attach(const std::string& name, uint64_t expectedVersion){
+        detach();
+
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(SharedSegmentHeader)){
+            close(fd);
+            return false;
+        }
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) return false;
+        segment = mapped;
+        segmentSize = info.st_size;
+
+        const SharedSegmentHeader* header = static_cast<const SharedSegmentHeader*>(mapped);
+        if (std::memcmp(header -> magic, SHARED_MAGIC, sizeof(SHARED_MAGIC)) != 0
+            || header -> ready.load(std::memory_order_acquire) != 1
+            || header -> version != expectedVersion
+            || header -> imageSize != segmentSize - sizeof(SharedSegmentHeader)){
+            detach();
+            return false;
+        }
+
+        const char* image = static_cast<const char*>(mapped) + sizeof(SharedSegmentHeader);
+        if (!view.open(image, header -> imageSize, config.hashfunc)){
+            detach();
+            return false;
+        }
+        return true;
+    }
+
+    bool isAttached() const { return view.isOpen(); }
+
+    SymbolRef lookup(const std::string& name) const {
+        return view.lookup(name, config);
+    }
+
+    // A private, mutable copy for a process that needs to change the table.
+    std::unique_ptr<SymbolTable> copyOut() const {
+        return view.isOpen() ? view.rebuild(config) : nullptr;
+    }
+};
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef SUGGESTINDEX_H
+#define SUGGESTINDEX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "SymbolInfo.hpp"
+#include "NodeStash.hpp"
+
+// Levenshtein distance: insertions, deletions and substitutions cost one.
+// Past limit the exact value does not matter and limit + 1 is returned as
+// soon as every path is known to exceed it.
+inline int editDistance(std::string_view a, std::string_view b, int limit = 1 << 30){
+    if (a.size() < b.size()) std::swap(a, b);
+    if ((int) (a.size() - b.size()) > limit) return limit + 1;
+
+    int small[64];
+    std::vector<int> large;
+    int* row = small;
+    if (b.size() >= 64){
+        large.resize(b.size() + 1);
+        row = large.data();
+    }
+    for (size_t j = 0; j <= b.size(); j++) row[j] = j;
+    for (size_t i = 1; i <= a.size(); i++){
+        int diagonal = row[0];
+        row[0] = i;
+        int best = row[0];
+        for (size_t j = 1; j <= b.size(); j++){
+            int above = row[j];
+            row[j] = std::min({above + 1, row[j - 1] + 1, diagonal + (a[i - 1] != b[j - 1])});
+            diagonal = above;
+            best = std::min(best, row[j]);
+        }
+        if (best > limit) return limit + 1;
+    }
+    return std::min(row[b.size()], limit + 1);
+}
+
+// Inverted index of letter pairs over one scope's names, for "did you
+// mean" queries. A name is padded with one NUL on each side and split into
+// its distinct pairs; each edit drops at most two pairs of the query, so a
+// name within d edits shares at least (query pairs - 2d) of them. Only
+// names reaching that count are measured with editDistance. Pairs rather
+// than trigrams, so short identifiers still have a usable bound.
+//
+// A removed name leaves its postings behind until removed names outnumber
+// live ones, then the index is rebuilt.
+class SuggestIndex{
+    typedef std::unordered_map<std::string_view, uint32_t> SlotMap;
+
+    std::vector<SymbolInfo*> slots; // nullptr once removed
+    SlotMap slotOf; // views into the live symbols
+    NodeStash<SlotMap> spareSlots; // kept by clear()
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings; // pair -> slots; cleared lists stay
+    size_t postingCount;
+    size_t dead;
+
+    static std::vector<uint32_t> pairsOf(std::string_view name){
+        std::vector<uint32_t> pairs;
+        unsigned char prev = 0;
+        for (size_t i = 0; i <= name.size(); i++){
+            unsigned char c = i < name.size() ? name[i] : 0;
+            pairs.push_back(prev << 8 | c);
+            prev = c;
+        }
+        std::sort(pairs.begin(), pairs.end());
+        pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+        return pairs;
+    }
+
+    void add(SymbolInfo* symbol){
+        uint32_t slot = slots.size();
+        slots.push_back(symbol);
+        spareSlots.emplace(slotOf, symbol -> getName(), slot);
+        for (uint32_t pair : pairsOf(symbol -> getName())){
+            postings[pair].push_back(slot);
+            postingCount++;
+        }
+    }
+
+    void rebuild(){
+        std::vector<SymbolInfo*> symbols;
+        for (SymbolInfo* symbol : slots){
+            if (symbol != nullptr) symbols.push_back(symbol);
+        }
+        clear();
+        for (SymbolInfo* symbol : symbols){
+            add(symbol);
+        }
+    }
+
+   public:
+    SuggestIndex() : postingCount(0), dead(0) {}
+
+    size_t size() const { return slots.size() - dead; }
+
+    // Drops every name but keeps the index's nodes and lists, so refilling
+    // it with similar names allocates nothing.
+    void clear(){
+        slots.clear();
+        spareSlots.takeAll(slotOf);
+        for (auto& posting : postings){
+            posting.second.clear();
+        }
+        postingCount = 0;
+        dead = 0;
+    }
+
+    void insert(SymbolInfo* symbol){
+        add(symbol);
+    }
+
+    void erase(const std::string& name){
+        auto it = slotOf.find(name);
+        if (it == slotOf.end()) return;
+        slots[it -> second] = nullptr;
+        slotOf.erase(it);
+        dead++;
+        if (dead > 32 && dead > size()) rebuild();
+    }
+
+    // visit(symbol, distance) for every live name within budget of name.
+    // Queries only read the index, so tables sharing a scope may run them
+    // from different threads.
+    template <class Visitor>
+    void forEachNear(const std::string& name, int budget, Visitor visit) const {
+        std::vector<uint32_t> pairs = pairsOf(name);
+        int needed = (int) pairs.size() - 2 * budget;
+        if (needed <= 0){
+            // too short for the bound to exclude anything
+            for (SymbolInfo* symbol : slots){
+                if (symbol == nullptr) continue;
+                int distance = editDistance(name, symbol -> getName(), budget);
+                if (distance <= budget) visit(symbol, distance);
+            }
+            return;
+        }
+
+        // per-thread scratch, all zero between queries
+        thread_local std::vector<int> counts;
+        thread_local std::vector<uint32_t> touched;
+        if (counts.size() < slots.size()) counts.resize(slots.size(), 0);
+        for (uint32_t pair : pairs){
+            auto it = postings.find(pair);
+            if (it == postings.end()) continue;
+            for (uint32_t slot : it -> second){
+                if (counts[slot]++ == 0) touched.push_back(slot);
+            }
+        }
+        for (uint32_t slot : touched){
+            if (counts[slot] >= needed && slots[slot] != nullptr){
+                int distance = editDistance(name, slots[slot] -> getName(), budget);
+                if (distance <= budget) visit(slots[slot], distance);
+            }
+            counts[slot] = 0;
+        }
+        touched.clear();
+    }
+
+    // Hash nodes estimated at two pointers plus their payload.
+    size_t bytes() const {
+        return sizeof(SuggestIndex) + slots.capacity() * sizeof(SymbolInfo*)
+               + (slotOf.size() + spareSlots.size()) * (2 * sizeof(void*) + sizeof(std::pair<std::string_view, uint32_t>))
+               + postings.size() * (2 * sizeof(void*) + sizeof(std::pair<uint32_t, std::vector<uint32_t>>))
+               + postingCount * sizeof(uint32_t);
+    }
+};
+
+#endif
@@ -0,0 +1,337 @@
+#ifndef SYMBOLATTRIBUTES_H
+#define SYMBOLATTRIBUTES_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+enum class DataType : uint8_t{
+    None,
+    Int,
+    Float,
+    Double,
+    Char,
+    Bool,
+    Void,
+};
+
+inline const char* dataTypeName(DataType type){
+    switch (type){
+        case DataType::Int: return "INT";
+        case DataType::Float: return "FLOAT";
+        case DataType::Double: return "DOUBLE";
+        case DataType::Char: return "CHAR";
+        case DataType::Bool: return "BOOL";
+        case DataType::Void: return "VOID";
+        default: return "";
+    }
+}
+
+// False, and type untouched, for a name that is not a DataType.
+inline bool parseDataType(std::string_view name, DataType* type){
+    for (DataType candidate : {DataType::Int, DataType::Float, DataType::Double, DataType::Char, DataType::Bool, DataType::Void}){
+        if (name == dataTypeName(candidate)){
+            *type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Text means the symbol has no attributes and its type is the text it was
+// inserted with.
+enum class SymbolKind : uint8_t{
+    Text,
+    Variable,
+    Function,
+    Struct,
+    Union,
+};
+
+enum SymbolFlag : uint16_t{
+    Constant = 1,
+    Static = 2,
+    Extern = 4,
+    Defined = 8,
+    Parameter = 16,
+};
+
+// A function parameter (name empty) or a struct/union field.
+struct ParamEntry{
+    DataType type;
+    std::string name;
+
+    bool operator<(const ParamEntry& other) const {
+        return type != other.type ? type < other.type : name < other.name;
+    }
+    bool operator==(const ParamEntry& other) const {
+        return type == other.type && name == other.name;
+    }
+};
+
+typedef std::vector<ParamEntry> ParamList;
+
+// Process-wide store of parameter and field lists, each kept once, so a
+// symbol refers to its list by a 32-bit handle and symbols with the same
+// signature share it. Handle 0 is the empty list. Lists are never freed,
+// which lets get() read without a lock: handles index fixed-size chunks
+// that never move once published. Room for 4M distinct lists.
+//
+// The bound: one list and one index entry per distinct signature ever
+// interned, whatever the number of symbols, tables or scopes, and however
+// often tables are cleared (BasicScopeTable::clear) or reclaimed
+// (ScopeReclaimer), neither of which gives lists back. A long-running
+// process grows only as far as the distinct signatures it sees.
+class ParamLists{
+    static constexpr uint32_t ChunkBits = 10;
+    static constexpr uint32_t MaxChunks = 1 << 12;
+
+    struct Chunk{
+        std::atomic<const ParamList*> lists[1 << ChunkBits];
+    };
+
+    static std::atomic<Chunk*>* chunks(){
+        static std::atomic<Chunk*> all[MaxChunks];
+        return all;
+    }
+
+    static std::mutex& lock(){
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Orders the published lists by contents; looked up with a ParamList.
+    struct ByContents{
+        using is_transparent = void;
+        bool operator()(const ParamList* a, const ParamList* b) const { return *a < *b; }
+        bool operator()(const ParamList* a, const ParamList& b) const { return *a < b; }
+        bool operator()(const ParamList& a, const ParamList* b) const { return a < *b; }
+    };
+
+    // Keys point at the published lists, so each list is stored once.
+    static std::map<const ParamList*, uint32_t, ByContents>& handles(){
+        static std::map<const ParamList*, uint32_t, ByContents> byList;
+        return byList;
+    }
+
+   public:
+    static uint32_t intern(const ParamList& list){
+        if (list.empty()) return 0;
+        std::lock_guard<std::mutex> guard(lock());
+        auto it = handles().find(list);
+        if (it != handles().end()) return it -> second;
+
+        uint32_t handle = handles().size() + 1;
+        if (handle >> ChunkBits >= MaxChunks) throw std::length_error("too many parameter lists");
+        std::atomic<Chunk*>& chunk = chunks()[handle >> ChunkBits];
+        if (chunk.load(std::memory_order_relaxed) == nullptr) chunk.store(new Chunk(), std::memory_order_release);
+        const ParamList* published = new ParamList(list);
+        chunk.load(std::memory_order_relaxed) -> lists[handle & ((1 << ChunkBits) - 1)].store(published, std::memory_order_release);
+        handles().emplace(published, handle);
+        return handle;
+    }
+
+    static const ParamList& get(uint32_t handle){
+        static const ParamList empty;
+        if (handle == 0) return empty;
+        Chunk* chunk = chunks()[handle >> ChunkBits].load(std::memory_order_acquire);
+        return *chunk -> lists[handle & ((1 << ChunkBits) - 1)].load(std::memory_order_acquire);
+    }
+};
+
+// Semantic attributes of a symbol, kept inline in its SymbolInfo so later
+// passes read them directly instead of parsing the type text; the text is
+// only produced when the symbol is printed.
+struct SymbolAttributes{
+    SymbolKind kind = SymbolKind::Text;
+    DataType dataType = DataType::None; // of a variable, or a function's return type
+    uint16_t flags = 0;                 // SymbolFlag bits
+    int32_t arrayLength = -1;           // -1 if not an array
+    uint32_t params = 0;                // ParamLists handle: parameters or fields
+    int32_t stackOffset = 0;
+
+    static SymbolAttributes variable(DataType type, int32_t arrayLength = -1){
+        SymbolAttributes attributes;
+        attributes.kind = SymbolKind::Variable;
+        attributes.dataType = type;
+        attributes.arrayLength = arrayLength;
+        return attributes;
+    }
+
+    static SymbolAttributes function(DataType returns, const ParamList& params){
+        SymbolAttributes attributes;
+        attributes.kind = SymbolKind::Function;
+        attributes.dataType = returns;
+        attributes.params = ParamLists::intern(params);
+        return attributes;
+    }
+
+    // kind is Struct or Union.
+    static SymbolAttributes record(SymbolKind kind, const ParamList& fields){
+        SymbolAttributes attributes;
+        attributes.kind = kind;
+        attributes.params = ParamLists::intern(fields);
+        return attributes;
+    }
+
+    bool isTyped() const { return kind != SymbolKind::Text; }
+    bool isArray() const { return arrayLength >= 0; }
+    bool hasFlag(SymbolFlag flag) const { return flags & flag; }
+    const ParamList& paramList() const { return ParamLists::get(params); }
+
+    // The text the drivers have always printed for such a declaration, e.g.
+    // "FUNCTION,INT<==(INT,FLOAT)" or "STRUCT,{(INT,a),(BOOL,b)}". An array
+    // prints its length after the type, as in "INT[10]".
+    void print(std::ostream& os) const {
+        switch (kind){
+            case SymbolKind::Text:
+                return;
+            case SymbolKind::Variable:
+                os << dataTypeName(dataType);
+                if (isArray()) os << "[" << arrayLength << "]";
+                return;
+            case SymbolKind::Function: {
+                os << "FUNCTION," << dataTypeName(dataType) << "<==(";
+                const ParamList& list = paramList();
+                for (size_t i = 0; i < list.size(); i++){
+                    if (i > 0) os << ",";
+                    os << dataTypeName(list[i].type);
+                }
+                os << ")";
+                return;
+            }
+            case SymbolKind::Struct:
+            case SymbolKind::Union: {
+                os << (kind == SymbolKind::Struct ? "STRUCT" : "UNION") << ",{";
+                const ParamList& list = paramList();
+                for (size_t i = 0; i < list.size(); i++){
+                    if (i > 0) os << ",";
+                    os << "(" << dataTypeName(list[i].type) << "," << list[i].name << ")";
+                }
+                os << "}";
+                return;
+            }
+        }
+    }
+
+    std::string text() const {
+        std::ostringstream os;
+        print(os);
+        return os.str();
+    }
+
+    // Reads text in the form print writes. False for anything else, and for
+    // text that would not print back exactly the same, so a caller can keep
+    // such a type as text without losing a character.
+    static bool parse(std::string_view text, SymbolAttributes* out){
+        SymbolAttributes attributes;
+        DataType type = DataType::None;
+        auto starts = [&](std::string_view prefix){
+            return text.substr(0, prefix.size()) == prefix;
+        };
+
+        if (starts("FUNCTION,")){
+            size_t arrow = text.find("<==(");
+            if (arrow == std::string_view::npos || text.back() != ')') return false;
+            if (!parseDataType(text.substr(9, arrow - 9), &type)) return false;
+            ParamList params;
+            std::string_view list = text.substr(arrow + 4, text.size() - arrow - 5);
+            while (!list.empty()){
+                size_t comma = list.find(',');
+                DataType param = DataType::None;
+                if (!parseDataType(list.substr(0, comma), &param)) return false;
+                params.push_back({param, ""});
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+            }
+            attributes = function(type, params);
+        }
+        else if (starts("STRUCT,{") || starts("UNION,{")){
+            if (text.back() != '}') return false;
+            size_t open = text.find('{');
+            std::string_view list = text.substr(open + 1, text.size() - open - 2);
+            ParamList fields;
+            while (!list.empty()){
+                size_t close = list.find(')');
+                size_t comma = list.find(',');
+                if (list[0] != '(' || close == std::string_view::npos || comma > close) return false;
+                DataType field = DataType::None;
+                if (!parseDataType(list.substr(1, comma - 1), &field)) return false;
+                fields.push_back({field, std::string(list.substr(comma + 1, close - comma - 1))});
+                list = list.substr(close + 1);
+                if (!list.empty()){
+                    if (list[0] != ',') return false;
+                    list = list.substr(1);
+                }
+            }
+            attributes = record(starts("STRUCT") ? SymbolKind::Struct : SymbolKind::Union, fields);
+        }
+        else if (!parseVariable(text, &attributes)){
+            return false;
+        }
+
+        if (attributes.text() != text) return false;
+        *out = attributes;
+        return true;
+    }
+
+    // A variable's type as print writes it, "INT" or "INT[10]": a DataType,
+    // then maybe a length of up to nine digits without leading zeros.
+    static bool parseVariable(std::string_view text, SymbolAttributes* out){
+        size_t bracket = text.find('[');
+        DataType type = DataType::None;
+        if (!parseDataType(text.substr(0, bracket), &type)) return false;
+        int32_t length = -1;
+        if (bracket != std::string_view::npos){
+            std::string_view digits = text.substr(bracket + 1);
+            if (digits.empty() || digits.back() != ']') return false;
+            digits.remove_suffix(1);
+            if (digits.empty() || digits.size() > 9 || (digits.size() > 1 && digits[0] == '0')) return false;
+            length = 0;
+            for (char c : digits){
+                if (c < '0' || c > '9') return false;
+                length = length * 10 + (c - '0');
+            }
+        }
+        *out = variable(type, length);
+        return true;
+    }
+};
+
+static_assert(sizeof(SymbolAttributes) == 16, "SymbolAttributes is meant to stay compact");
+
+// Process-wide store of the text typed attributes print, each distinct text
+// kept once, so a symbol can hand its type out by reference. Entries never
+// move or go, with the same bound as ParamLists: one per distinct type.
+class TypeTexts{
+    typedef std::tuple<SymbolKind, DataType, int32_t, uint32_t> Key; // what print reads
+
+    static std::mutex& lock(){
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::map<Key, std::string>& texts(){
+        static std::map<Key, std::string> byKey;
+        return byKey;
+    }
+
+   public:
+    static const std::string& of(const SymbolAttributes& attributes){
+        Key key(attributes.kind, attributes.dataType, attributes.arrayLength, attributes.params);
+        std::lock_guard<std::mutex> guard(lock());
+        auto it = texts().find(key);
+        if (it == texts().end()) it = texts().emplace(key, attributes.text()).first;
+        return it -> second;
+    }
+};
+
+#endif
@@ -1,26 +1,50 @@
 #ifndef SYMBOLINFO_H
 #define SYMBOLINFO_H
 
+#include <ostream>
 #include <string>
+#include "SymbolAttributes.hpp"
 
 class SymbolInfo {
-    std::string name;    
-    std::string type;    
-    SymbolInfo* next;    
+    std::string name;
+    std::string type;    // as inserted; empty when attributes carry the type
+    SymbolInfo* next;
+    SymbolAttributes attributes;
+    const std::string* printed; // TypeTexts entry of typed attributes, nullptr otherwise
+
+    static const std::string* printedOf(const SymbolAttributes& attributes){
+        return attributes.isTyped() ? &TypeTexts::of(attributes) : nullptr;
+    }
 
    public:
-    SymbolInfo(const std::string& name = "", const std::string& type = "")
-    : name(name), type(type), next(nullptr) {}
+    SymbolInfo(const std::string& name = "", const std::string& type = "", const SymbolAttributes& attributes = SymbolAttributes())
+    : name(name), type(type), next(nullptr), attributes(attributes), printed(printedOf(attributes)) {}
 
     const std::string& getName() const { return name; }
-    const std::string& getType() const { return type; }
+    // The type as printed, for a typed symbol too; see getInsertedType.
+    const std::string& getType() const { return printed != nullptr ? *printed : type; }
+    // The text the symbol was inserted with, empty when its attributes carry the type.
+    const std::string& getInsertedType() const { return type; }
     SymbolInfo* getNext() const { return next; }
+    const SymbolAttributes& getAttributes() const { return attributes; }
 
     void setName(const std::string& newName) { name = newName; }
     void setType(const std::string& newType) { type = newType; }
     void setNext(SymbolInfo* newNext) { next = newNext; }
+    void setAttributes(const SymbolAttributes& newAttributes){
+        attributes = newAttributes;
+        printed = printedOf(attributes);
+    }
+
+    void printType(std::ostream& os) const {
+        os << getType();
+    }
+
+    // getType() built afresh from the attributes, for a caller that wants
+    // its own copy.
+    std::string typeText() const {
+        return attributes.isTyped() ? attributes.text() : type;
+    }
 };
 
 #endif
-
-
@@ -0,0 +1,443 @@
+#ifndef SYMBOLSNAPSHOT_H
+#define SYMBOLSNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SymbolTable.hpp"
+
+// Binary image of a SymbolTable. Every reference inside the image is a byte
+// offset from its start, so the file can be mmap'ed anywhere and searched in
+// place without building a single SymbolInfo.
+//
+//   SnapshotHeader
+//   SnapshotScope[scopeCount]        global scope first, current scope last
+//   per scope: uint32 bucket[numBuckets] offset of the first entry, 0 if empty
+//   entries: SnapshotEntry, name bytes, type bytes, padded to 4 bytes
+//
+// Chains keep their order, so positions reported from the image are the
+// ones the live table would report.
+
+const char SNAPSHOT_MAGIC[8] = {'S', 'Y', 'M', 'S', 'N', 'A', 'P', '1'};
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t imageSize;
+    uint32_t numBuckets;
+    uint32_t scopeCount;
+    uint32_t nextId;
+    uint32_t hashFingerprint;
+};
+
+struct SnapshotScope{
+    uint32_t id;
+    uint32_t bucketsOffset;
+};
+
+struct SnapshotEntry{
+    uint32_t next;
+    uint32_t nameLength;
+    uint32_t typeLength;
+};
+
+// A name/type pair that points either into a mapped image or at a SymbolInfo.
+struct SymbolRef{
+    std::string_view name;
+    std::string_view type;
+
+    explicit operator bool() const { return name.data() != nullptr; }
+};
+
+// The hash itself can't be stored, so the image records what it makes of a
+// few fixed strings and refuses to load under a different hash function.
+inline uint32_t hashFingerprint(unsigned long (*hashfunc) (const std::string&, const int)){
+    const char* probes[] = {"a", "main", "SymbolTable", "x_1y_2z_3"};
+    uint32_t fingerprint = 0;
+    for (const char* probe : probes){
+        fingerprint = fingerprint * 31 + (uint32_t) hashfunc(probe, 65521);
+    }
+    return fingerprint;
+}
+
+inline void appendBytes(std::vector<char>& image, const void* data, size_t size){
+    const char* bytes = static_cast<const char*>(data);
+    image.insert(image.end(), bytes, bytes + size);
+}
+
+// Appends the bucket array and entries of one scope; returns the bucket offset.
+template <class Logger>
+uint32_t writeScopeImage(BasicScopeTable<Logger>& scope, std::vector<char>& image){
+    int n = scope.getNumBuckets();
+    uint32_t bucketsOffset = image.size();
+    image.resize(image.size() + n * sizeof(uint32_t), 0);
+
+    for (int i = 0; i < n; i++){
+        uint32_t link = bucketsOffset + i * sizeof(uint32_t);
+        for (SymbolInfo* current = scope.getBucket(i); current != nullptr; current = current -> getNext()){
+            uint32_t offset = image.size();
+            std::memcpy(&image[link], &offset, sizeof(offset));
+
+            const std::string& type = current -> getType();
+            SnapshotEntry entry = {0, (uint32_t) current -> getName().size(), (uint32_t) type.size()};
+            appendBytes(image, &entry, sizeof(entry));
+            appendBytes(image, current -> getName().data(), entry.nameLength);
+            appendBytes(image, type.data(), entry.typeLength);
+            image.resize((image.size() + 3) & ~size_t(3), 0);
+            link = offset + offsetof(SnapshotEntry, next);
+        }
+    }
+    return bucketsOffset;
+}
+
+// Empty if the table does not fit: every offset in the image, and its size,
+// is 32 bits.
+template <class Logger>
+std::vector<char> writeSnapshotImage(BasicSymbolTable<Logger>& st){
+    std::vector<BasicScopeTable<Logger>*> scopes;
+    for (size_t depth = 0; depth <= st.getDepth(); depth++){
+        scopes.push_back(st.getScope(depth));
+    }
+
+    std::vector<char> image(sizeof(SnapshotHeader) + scopes.size() * sizeof(SnapshotScope), 0);
+    std::vector<SnapshotScope> records;
+    for (BasicScopeTable<Logger>* scope : scopes){
+        records.push_back({(uint32_t) scope -> getId(), writeScopeImage(*scope, image)});
+        if (image.size() > UINT32_MAX) return {};
+    }
+
+    SnapshotHeader header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.imageSize = image.size();
+    header.numBuckets = st.getNumBuckets();
+    header.scopeCount = scopes.size();
+    header.nextId = st.getNextId();
+    header.hashFingerprint = hashFingerprint(st.getConfig().hashfunc);
+
+    std::memcpy(&image[0], &header, sizeof(header));
+    std::memcpy(&image[sizeof(header)], records.data(), records.size() * sizeof(SnapshotScope));
+    return image;
+}
+
+template <class Logger>
+bool saveSnapshot(BasicSymbolTable<Logger>& st, const std::string& path){
+    std::vector<char> image = writeSnapshotImage(st);
+    if (image.empty()) return false;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(image.data(), image.size());
+    return bool(out);
+}
+
+// Read-only access to an image already in memory (a mapped file or a
+// shared-memory segment). It does not own the bytes.
+class SnapshotView{
+    const char* image;
+    size_t imageSize;
+    const SnapshotHeader* header;
+    const SnapshotScope* scopes;
+
+    const uint32_t* bucketsOf(int scope) const {
+        return reinterpret_cast<const uint32_t*>(image + scopes[scope].bucketsOffset);
+    }
+
+    const SnapshotEntry* entryAt(uint32_t offset) const {
+        return offset == 0 ? nullptr : reinterpret_cast<const SnapshotEntry*>(image + offset);
+    }
+
+    static std::string_view nameOf(const SnapshotEntry* entry){
+        return std::string_view(reinterpret_cast<const char*>(entry + 1), entry -> nameLength);
+    }
+
+    static std::string_view typeOf(const SnapshotEntry* entry){
+        return std::string_view(reinterpret_cast<const char*>(entry + 1) + entry -> nameLength, entry -> typeLength);
+    }
+
+    // Checks every offset once, so lookups can trust the image.
+    bool validate(unsigned long (*hashfunc) (const std::string&, const int)) const {
+        if (imageSize < sizeof(SnapshotHeader)) return false;
+        if (std::memcmp(header -> magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) return false;
+        if (header -> version != SNAPSHOT_VERSION || header -> imageSize != imageSize) return false;
+        if (header -> hashFingerprint != hashFingerprint(hashfunc)) return false;
+        if (header -> numBuckets == 0 || header -> scopeCount == 0) return false;
+
+        size_t n = header -> numBuckets;
+        if (sizeof(SnapshotHeader) + header -> scopeCount * sizeof(SnapshotScope) > imageSize) return false;
+        for (uint32_t s = 0; s < header -> scopeCount; s++){
+            if (scopes[s].bucketsOffset % 4 != 0 || scopes[s].bucketsOffset + n * sizeof(uint32_t) > imageSize) return false;
+            const uint32_t* buckets = bucketsOf(s);
+            for (size_t i = 0; i < n; i++){
+                size_t steps = 0;
+                for (uint32_t offset = buckets[i]; offset != 0; offset = entryAt(offset) -> next){
+                    if (offset % 4 != 0 || offset + sizeof(SnapshotEntry) > imageSize) return false;
+                    const SnapshotEntry* entry = entryAt(offset);
+                    if ((size_t) offset + sizeof(SnapshotEntry) + entry -> nameLength + entry -> typeLength > imageSize) return false;
+                    if (++steps > imageSize / sizeof(SnapshotEntry)) return false; // a cycle
+                }
+            }
+        }
+        return true;
+    }
+
+   public:
+    SnapshotView() : image(nullptr), imageSize(0), header(nullptr), scopes(nullptr) {}
+
+    // Accepts the image only if it is well formed and was written with hashfunc.
+    bool open(const char* data, size_t size, unsigned long (*hashfunc) (const std::string&, const int)){
+        image = data;
+        imageSize = size;
+        header = reinterpret_cast<const SnapshotHeader*>(image);
+        scopes = reinterpret_cast<const SnapshotScope*>(image + sizeof(SnapshotHeader));
+        if (image == nullptr || !validate(hashfunc)){
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close(){
+        image = nullptr;
+        imageSize = 0;
+        header = nullptr;
+        scopes = nullptr;
+    }
+
+    bool isOpen() const { return image != nullptr; }
+    const char* data() const { return image; }
+    size_t size() const { return imageSize; }
+
+    uint32_t numBuckets() const { return header -> numBuckets; }
+    uint32_t scopeCount() const { return header -> scopeCount; }
+    int scopeId(uint32_t scope) const { return scopes[scope].id; }
+    int nextId() const { return header -> nextId; }
+
+    unsigned long bucketOf(const std::string& name, unsigned long (*hashfunc) (const std::string&, const int)) const {
+        return hashfunc(name, header -> numBuckets) % header -> numBuckets;
+    }
+
+    // Searches one scope (0 is the global one) in the name's bucket, with
+    // the log line a live table writes for a hit.
+    SymbolRef lookupScope(uint32_t scope, unsigned long index, const std::string& name, std::ostream* os) const {
+        int position = 1;
+        for (const SnapshotEntry* entry = entryAt(bucketsOf(scope)[index]); entry != nullptr; entry = entryAt(entry -> next)){
+            if (nameOf(entry) == name){
+                if (os != nullptr) formatEvent(*os, {TableOp::Found, (int) scopes[scope].id, index, position, &name, scope == 0});
+                return {nameOf(entry), typeOf(entry)};
+            }
+            position++;
+        }
+        return SymbolRef();
+    }
+
+    // The builtin scope, searched after the image's scopes as
+    // SymbolTable::lookup searches it after its own.
+    static SymbolRef lookupBuiltin(const std::string& name, const BuiltinScopeView& builtins, std::ostream* os){
+        int bucket = 0, position = 0;
+        int index = builtins.find(name, &bucket, &position);
+        if (index < 0) return SymbolRef();
+        if (os != nullptr) formatEvent(*os, {TableOp::Found, 0, (unsigned long) bucket - 1, position, &name, true});
+        return {builtins.symbols[index].name, builtins.symbols[index].type};
+    }
+
+    // Innermost scope first, then config's builtins, like SymbolTable::lookup,
+    // with the same log lines to config.os.
+    SymbolRef lookup(const std::string& name, const ScopeConfig& config) const {
+        if (image == nullptr) return SymbolRef();
+
+        unsigned long index = bucketOf(name, config.hashfunc);
+        for (uint32_t scope = header -> scopeCount; scope-- > 0;){
+            SymbolRef found = lookupScope(scope, index, name, config.os);
+            if (found) return found;
+        }
+        return lookupBuiltin(name, config.builtins, config.os);
+    }
+
+    // Inserts the symbols of one image scope into scope, chain by chain, so
+    // they land at the same positions. Logs through scope's logger.
+    template <class Logger>
+    void fillScope(uint32_t index, BasicScopeTable<Logger>& scope) const {
+        const uint32_t* buckets = bucketsOf(index);
+        for (uint32_t i = 0; i < header -> numBuckets; i++){
+            for (const SnapshotEntry* entry = entryAt(buckets[i]); entry != nullptr; entry = entryAt(entry -> next)){
+                SymbolAttributes attributes;
+                if (SymbolAttributes::parse(typeOf(entry), &attributes))
+                    scope.insert(std::string(nameOf(entry)), attributes);
+                else
+                    scope.insert(std::string(nameOf(entry)), std::string(typeOf(entry)));
+            }
+        }
+    }
+
+    // Rebuilds the image as a mutable table: same scope ids, same chain order.
+    std::unique_ptr<SymbolTable> rebuild(const ScopeConfig& config) const {
+        ScopeConfig quiet = config;
+        quiet.os = nullptr;
+        auto st = std::make_unique<SymbolTable>(header -> numBuckets, quiet);
+        for (uint32_t s = 0; s < header -> scopeCount; s++){
+            if (s > 0){
+                st -> setNextId(scopes[s].id);
+                st -> enterScope();
+            }
+            fillScope(s, *st -> getCurrentScope());
+        }
+        st -> setNextId(header -> nextId);
+        st -> setOutputStream(config.os);
+        return st;
+    }
+};
+
+// Read-only view of a snapshot file, searched in place. Changes promote it
+// one scope at a time, copy-on-write: the first one builds an ordinary
+// SymbolTable whose scopes are empty stand-ins for the image's (time
+// proportional to the depth), and an insert or remove then copies in only
+// the scope it changes, the current one. Scopes never changed are still
+// searched in the image, and exiting one copies nothing. The mapping is
+// dropped once no scope is left in it.
+class MappedSymbolTable{
+    SnapshotView view;
+    SymbolTable* promoted;
+    size_t mapped; // once promoted: this many bottom scopes are stand-ins still searched in view
+    ScopeConfig config;
+
+    void unmap(){
+        if (view.isOpen()) munmap(const_cast<char*>(view.data()), view.size());
+        view.close();
+    }
+
+    SymbolTable& split(){
+        if (promoted != nullptr) return *promoted;
+        ScopeConfig quiet = config;
+        quiet.os = nullptr;
+        promoted = new SymbolTable(view.numBuckets(), quiet);
+        for (uint32_t s = 1; s < view.scopeCount(); s++){
+            promoted -> setNextId(view.scopeId(s));
+            promoted -> enterScope();
+        }
+        promoted -> setNextId(view.nextId());
+        promoted -> setOutputStream(config.os);
+        mapped = view.scopeCount();
+        return *promoted;
+    }
+
+    // Copies the image's scopes from depth up into their stand-ins; every
+    // scope above depth must already be promoted.
+    void promoteFrom(size_t depth){
+        if (depth >= mapped) return;
+        promoted -> setOutputStream(nullptr);
+        for (size_t d = depth; d < mapped; d++){
+            view.fillScope(d, *promoted -> getScope(d));
+        }
+        promoted -> setOutputStream(config.os);
+        mapped = depth;
+        if (mapped == 0) unmap();
+    }
+
+    // The table, with its current scope promoted.
+    SymbolTable& writable(){
+        split();
+        promoteFrom(promoted -> getDepth());
+        return *promoted;
+    }
+
+    SymbolRef refTo(SymbolInfo* found){
+        if (found == nullptr) return SymbolRef();
+        return {found -> getName(), found -> getType()};
+    }
+
+   public:
+    MappedSymbolTable(const ScopeConfig& cfg = ScopeConfig()) : promoted(nullptr), mapped(0), config(cfg) {}
+
+    ~MappedSymbolTable(){
+        unmap();
+        delete promoted;
+    }
+
+    MappedSymbolTable(const MappedSymbolTable&) = delete;
+    MappedSymbolTable& operator=(const MappedSymbolTable&) = delete;
+
+    bool load(const std::string& path){
+        unmap();
+        delete promoted;
+        promoted = nullptr;
+        mapped = 0;
+
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0){
+            close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) return false;
+
+        if (!view.open(static_cast<const char*>(data), info.st_size, config.hashfunc)){
+            munmap(data, info.st_size);
+            return false;
+        }
+        return true;
+    }
+
+    bool isPromoted() const { return promoted != nullptr; }
+
+    // Scopes still searched in the mapped image.
+    size_t mappedScopes() const {
+        if (promoted != nullptr) return mapped;
+        return view.isOpen() ? view.scopeCount() : 0;
+    }
+
+    // The mutable table, every scope promoted: costs time proportional to
+    // what is still mapped. Needs a successful load first.
+    SymbolTable& table(){
+        split();
+        promoteFrom(0);
+        return *promoted;
+    }
+
+    SymbolRef lookup(const std::string& name){
+        if (promoted == nullptr) return view.lookup(name, config);
+        if (mapped == 0) return refTo(promoted -> lookup(name));
+
+        unsigned long index = view.bucketOf(name, config.hashfunc);
+        for (size_t depth = promoted -> getDepth(); depth >= mapped; depth--){
+            if (SymbolInfo* found = promoted -> getScope(depth) -> lookupAt(index, name)) return refTo(found);
+        }
+        for (size_t depth = mapped; depth-- > 0;){
+            SymbolRef found = view.lookupScope(depth, index, name, config.os);
+            if (found) return found;
+        }
+        return SnapshotView::lookupBuiltin(name, config.builtins, config.os);
+    }
+
+    bool insert(const std::string& name, const std::string& type){
+        return writable().insert(name, type);
+    }
+
+    bool remove(const std::string& name){
+        return writable().remove(name);
+    }
+
+    void enterScope(){
+        split().enterScope();
+    }
+
+    void exitScope(){
+        split().exitScope();
+        mapped = std::min(mapped, promoted -> getDepth() + 1);
+    }
+};
+
+#endif
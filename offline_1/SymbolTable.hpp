@@ -1,110 +1,665 @@
 #ifndef SYMBOLTABLE_H
 #define SYMBOLTABLE_H
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include "ScopeTable.hpp"
+#include "ScopeReclaimer.hpp"
 
-class SymbolTable{
-    ScopeTable* currentScope;
+// Logger works as for BasicScopeTable; SymbolTable below logs as text.
+template <class Logger>
+class BasicSymbolTable{
+    typedef BasicScopeTable<Logger> ScopeType;
+
+    // The display: scopes[k] is the live scope at depth k, the global scope
+    // first and the current one last, so lookups walk a dense array. A scope
+    // may be shared with forks of this table (see fork).
+    std::vector<std::shared_ptr<ScopeType>> scopes;
+    unsigned long long tag; // owner tag of the scopes this table made
     int num_buckets;
-    static std::ostream* outputStream;
+    int nextId;
+    ScopeConfig config;
+    Logger logger;
+    ProbeStats counters; // scope visits of lookup/lookupMany
+    ScopeStats retired;  // everything counted by scopes that have exited
+    std::vector<SymbolInfo*> builtinSymbols; // built the first time a builtin is found
+
+    // Undo log, kept only while a mark is open. Removed symbols and exited
+    // scopes are held here rather than freed, so a rollback relinks the
+    // very same objects and pointers handed out before stay valid. Inserts
+    // and removes always happened in the scope that is current again when
+    // they are undone.
+    struct Change{
+        enum Kind{ Inserted, Removed, Entered, Exited } kind;
+        ScopeType* scope;                // Removed: the scope it left
+        std::shared_ptr<ScopeType> kept; // Exited: the scope itself
+        SymbolInfo* symbol;              // Removed: the detached node
+        SymbolInfo* prev;                // Removed: its chain predecessor
+        std::string name;                // Inserted
+    };
+    std::vector<Change> changes;
+    std::vector<ScopeStats> retiredBefore; // retired as each Exited change found it
+    size_t openMarks;
+    unsigned long long generation; // stamped on each Mark; a new one after clear()
+    std::vector<std::shared_ptr<ScopeType>> spareScopes; // emptied by clear(), reused by enterScope
+    std::unique_ptr<ScopeReclaimer<ScopeType>> reclaimer; // frees exited scopes unless config.reclaim is Inline
+
+    void undo(Change& change){
+        switch (change.kind){
+            case Change::Inserted:
+                delete writableScope() -> detach(change.name, nullptr, true);
+                break;
+            case Change::Removed: {
+                ScopeType* scope = writableScope();
+                scope -> reattach(change.symbol, change.prev, scope != change.scope);
+                break;
+            }
+            case Change::Entered:
+                scopes.pop_back();
+                break;
+            case Change::Exited:
+                scopes.push_back(std::move(change.kept));
+                retired = retiredBefore.back();
+                retiredBefore.pop_back();
+                break;
+        }
+    }
+
+    // The last mark is closed: what the log still holds is gone for good.
+    void release(){
+        for (Change& change : changes){
+            if (change.kind == Change::Removed) delete change.symbol;
+            if (change.kind == Change::Exited && reclaimer != nullptr) reclaimer -> retire(std::move(change.kept), false);
+        }
+        changes.clear();
+        retiredBefore.clear();
+    }
+
+    static std::unique_ptr<ScopeReclaimer<ScopeType>> newReclaimer(const ScopeConfig& config){
+        if (config.reclaim == ReclaimMode::Inline) return nullptr;
+        return std::make_unique<ScopeReclaimer<ScopeType>>(config);
+    }
+
+    // An amortized reclamation step, taken on every insert, remove and scope change.
+    void reclaimSome(){
+        if (reclaimer != nullptr) reclaimer -> step();
+    }
+
+    static unsigned long long newTag(){
+        static std::atomic<unsigned long long> next(1);
+        return next++;
+    }
+
+    // Scopes made here log their creation themselves and leave their
+    // removal to the table, which may not be the last one holding them.
+    std::shared_ptr<ScopeType> newScope(ScopeType* parent){
+        auto scope = std::make_shared<ScopeType>(num_buckets, parent, nextId++, config);
+        scope -> setSilentExit(true);
+        scope -> setOwner(tag);
+        return scope;
+    }
+
+    // True if no other table holds the scope at depth and this table made
+    // it, so it may be changed in place and logs to this table's sinks.
+    bool ownsScope(size_t depth) const {
+        if (scopes[depth] -> getOwner() != tag || scopes[depth].use_count() != 1) return false;
+        std::atomic_thread_fence(std::memory_order_acquire); // after other holders' last reads
+        return true;
+    }
+
+    // The current scope, copied first if it is shared.
+    ScopeType* writableScope(){
+        if (!ownsScope(scopes.size() - 1)){
+            auto copy = std::make_shared<ScopeType>(std::shared_ptr<const ScopeType>(scopes.back()), config);
+            copy -> setOwner(tag);
+            scopes.back() = std::move(copy);
+        }
+        return scopes.back().get();
+    }
+
+    // A scope this table does not own is only read; the lookup is logged and
+    // counted here instead. index may be ScopeType::Unhashed (see
+    // ScopeTable::lookupHashing), and is set once the name is hashed.
+    SymbolInfo* lookupIn(size_t depth, unsigned long& index, const std::string& name){
+        if (ownsScope(depth)) return scopes[depth] -> lookupHashing(index, name);
+        if (index == ScopeType::Unhashed) index = scopes[depth] -> bucketOf(name);
+        int position = 0;
+        SymbolInfo* found = scopes[depth] -> findAt(index, name, &position);
+        if (found == nullptr){
+            counters.misses++;
+            counters.missProbes += position;
+            return nullptr;
+        }
+        if constexpr (Logger::enabled) {
+            logger.log({TableOp::Found, scopes[depth] -> getId(), index, position, &name, depth == 0});
+        }
+        counters.hits++;
+        counters.hitProbes += position;
+        return found;
+    }
+
+    void logScopeRemoved(size_t depth){
+        if constexpr (Logger::enabled) {
+            logger.log({TableOp::ScopeRemoved, scopes[depth] -> getId(), 0, 0, nullptr, depth == 0});
+        }
+    }
+
+    struct ForkTag{};
+
+    // See fork.
+    BasicSymbolTable(const BasicSymbolTable& from, ForkTag)
+    : scopes(from.scopes), tag(newTag()), num_buckets(from.num_buckets), nextId(from.nextId),
+      config(from.config), logger(from.config.os, from.config.observer), retired(from.retired), openMarks(0),
+      generation(newTag()), reclaimer(newReclaimer(config)){}
+
+    struct CloneTag{};
+
+    // See clone.
+    BasicSymbolTable(const BasicSymbolTable& from, CloneTag)
+    : tag(newTag()), num_buckets(from.num_buckets), nextId(from.nextId), config(from.config),
+      logger(from.config.os, from.config.observer), counters(from.counters), retired(from.retired), openMarks(0),
+      generation(newTag()), reclaimer(newReclaimer(config)){
+        ScopeType* parent = nullptr;
+        for (const auto& scope : from.scopes){
+            auto copy = std::make_shared<ScopeType>(scope -> clone(parent, config));
+            copy -> setSilentExit(true);
+            copy -> setOwner(tag);
+            parent = copy.get();
+            scopes.push_back(std::move(copy));
+        }
+    }
+
+    // The builtin scope has no SymbolInfo nodes of its own; a symbol gets
+    // one made the first time it is returned and kept, so callers see the
+    // usual pointer.
+    SymbolInfo* builtinSymbol(int index){
+        if (builtinSymbols.empty()) builtinSymbols.resize(config.builtins.size(), nullptr);
+        if (builtinSymbols[index] == nullptr){
+            const BuiltinSymbol& symbol = config.builtins.symbols[index];
+            builtinSymbols[index] = new SymbolInfo(std::string(symbol.name), std::string(symbol.type));
+        }
+        return builtinSymbols[index];
+    }
+
+    SymbolInfo* lookupBuiltin(const std::string& name){
+        if (config.builtins.empty()) return nullptr;
+        counters.scopesVisited++;
+
+        int bucket = 0, position = 0;
+        int index = config.builtins.find(name, &bucket, &position);
+        if (index < 0) return nullptr;
+
+        if constexpr (Logger::enabled) {
+            logger.log({TableOp::Found, 0, (unsigned long) bucket - 1, position, &name, true});
+        }
+        return builtinSymbol(index);
+    }
 
    public:
-    SymbolTable(int n) : num_buckets(n){
-        currentScope = new ScopeTable(n, nullptr); 
+    // State to return to with rollback. level is how many marks were open
+    // before this one; generation ties it to this table until clear().
+    struct Mark{
+        size_t changes;
+        size_t level;
+        int nextId;
+        unsigned long long generation;
+    };
+
+    BasicSymbolTable(int n, const ScopeConfig& cfg = ScopeConfig())
+    : tag(newTag()), num_buckets(n), nextId(1), config(cfg), logger(cfg.os, cfg.observer), openMarks(0),
+      generation(newTag()), reclaimer(newReclaimer(config)){
+        scopes.push_back(newScope(nullptr));
+    }
+
+    // Copying is explicit, through clone() or fork().
+    BasicSymbolTable(const BasicSymbolTable&) = delete;
+    BasicSymbolTable& operator=(const BasicSymbolTable&) = delete;
+
+    // O(1): the scopes are held by pointer, so they, the symbols in them and
+    // pointers handed out before all stay where they are. other is left
+    // without scopes, fit only to be destroyed or assigned to.
+    BasicSymbolTable(BasicSymbolTable&& other) noexcept
+    : scopes(std::move(other.scopes)), tag(other.tag), num_buckets(other.num_buckets), nextId(other.nextId),
+      config(other.config), logger(other.logger), counters(other.counters), retired(other.retired),
+      builtinSymbols(std::move(other.builtinSymbols)), changes(std::move(other.changes)),
+      retiredBefore(std::move(other.retiredBefore)), openMarks(std::exchange(other.openMarks, 0)),
+      generation(other.generation), spareScopes(std::move(other.spareScopes)), reclaimer(std::move(other.reclaimer)){
+        other.scopes.clear();
+        other.builtinSymbols.clear();
+        other.changes.clear();
+        other.spareScopes.clear();
+    }
+
+    // The table this one held is destroyed, logging its scopes' removal.
+    BasicSymbolTable& operator=(BasicSymbolTable&& other) noexcept {
+        BasicSymbolTable taken(std::move(other));
+        swap(taken);
+        return *this;
     }
 
-    ~SymbolTable(){
-        while (currentScope != nullptr){
-            ScopeTable* parent = currentScope -> getParent();
-            int id = currentScope -> getId();
-            delete currentScope;
-            currentScope = parent;
+    void swap(BasicSymbolTable& other) noexcept {
+        scopes.swap(other.scopes);
+        std::swap(tag, other.tag);
+        std::swap(num_buckets, other.num_buckets);
+        std::swap(nextId, other.nextId);
+        std::swap(config, other.config);
+        std::swap(logger, other.logger);
+        std::swap(counters, other.counters);
+        std::swap(retired, other.retired);
+        builtinSymbols.swap(other.builtinSymbols);
+        changes.swap(other.changes);
+        retiredBefore.swap(other.retiredBefore);
+        std::swap(openMarks, other.openMarks);
+        std::swap(generation, other.generation);
+        spareScopes.swap(other.spareScopes);
+        reclaimer.swap(other.reclaimer);
+    }
+
+    ~BasicSymbolTable(){
+        release();
+        while (!scopes.empty()){
+            logScopeRemoved(scopes.size() - 1);
+            scopes.pop_back();
+        }
+        for (SymbolInfo* symbol : builtinSymbols){
+            delete symbol;
+        }
+    }
+
+    // Redirects this table and every scope it made and still holds.
+    void setOutputStream(std::ostream* os) {
+        config.os = os;
+        logger.setOutputStream(os);
+        for (auto& scope : scopes){
+            if (scope -> getOwner() == tag) scope -> setOutputStream(os);
+        }
+        for (Change& change : changes){
+            if (change.kind == Change::Exited && change.kept -> getOwner() == tag) change.kept -> setOutputStream(os);
+        }
+        for (auto& scope : spareScopes){
+            scope -> setOutputStream(os);
         }
     }
 
-    static void setOutputStream(std::ostream* os) {
-        outputStream = os;
+    // An independent table with the same scopes, symbols, ids and config,
+    // for trying several continuations from one point. Costs O(depth): the
+    // scopes are shared copy-on-write, and either table copies one only when
+    // it first inserts into or removes from it, and then clones only the
+    // chains it changes. A shared scope is only read, so the bucket policy
+    // is not applied to it. Open marks are not carried over. Forks may be
+    // used from different threads, but a scope reached through getScope or
+    // getCurrentScope may be shared, and must then only be read.
+    BasicSymbolTable fork(){
+        return BasicSymbolTable(*this, ForkTag());
     }
 
-    // static void setHashFunction(unsigned long (*func)(const std::string&, const int)) {
-    //     ScopeTable::setHashFunction(func); 
-    // }
+    // A deep copy sharing nothing with this table: the same scopes, symbols,
+    // ids, config and counters, each chain copied in order. Costs time and
+    // memory proportional to the symbols, where fork costs O(depth); use it
+    // when the copy must outlive or be changed independently of shared
+    // scopes' owners. Open marks are not carried over. Nothing is logged.
+    BasicSymbolTable clone() const {
+        return BasicSymbolTable(*this, CloneTag());
+    }
+
+    // Back to a freshly constructed table, for the next job in a pool of
+    // tables: every scope is removed (logged as on destruction) and a new
+    // global scope created, counters start over and open marks are closed.
+    // The scopes and symbol nodes this table owns are kept, emptied, and
+    // reused by the global scope and later enterScope calls, so a job no
+    // larger than the last allocates nothing for them.
+    void clear(){
+        release();
+        openMarks = 0;
+        generation = newTag();
+        while (scopes.size() > 1){
+            logScopeRemoved(scopes.size() - 1);
+            if (ownsScope(scopes.size() - 1)){
+                scopes.back() -> clear();
+                spareScopes.push_back(std::move(scopes.back()));
+            }
+            scopes.pop_back();
+        }
+        logScopeRemoved(0);
+        nextId = 1;
+        if (ownsScope(0))
+            scopes[0] -> reopen(nullptr, nextId++);
+        else
+            scopes[0] = newScope(nullptr);
+        counters = ProbeStats();
+        retired = ScopeStats();
+        if (reclaimer != nullptr) reclaimer -> forgetStats();
+    }
+
+    const ScopeConfig& getConfig() const { return config; }
+    ScopeType* getCurrentScope() { return scopes.back().get(); }
+
+    // Depth of the current scope; the global scope is depth 0.
+    size_t getDepth() const { return scopes.size() - 1; }
+
+    // The live scope at depth, in O(1).
+    ScopeType* getScope(size_t depth) { return scopes[depth].get(); }
+    int getNumBuckets() const { return num_buckets; }
+    int getNextId() const { return nextId; }
+
+    // Bytes of exited scopes still waiting to be freed; 0 under ReclaimMode::Inline.
+    size_t getPendingReclaim(){
+        return reclaimer == nullptr ? 0 : reclaimer -> pendingSize();
+    }
+
+    // Id the next enterScope will use; lets a saved table be rebuilt with its ids.
+    void setNextId(int id){
+        nextId = id;
+    }
 
     void enterScope(){
-        ScopeTable* newScope = new ScopeTable(num_buckets, currentScope);
-        currentScope = newScope;
+        if (spareScopes.empty())
+            scopes.push_back(newScope(scopes.back().get()));
+        else {
+            spareScopes.back() -> reopen(scopes.back().get(), nextId++);
+            scopes.push_back(std::move(spareScopes.back()));
+            spareScopes.pop_back();
+        }
+        reclaimSome();
+        if (openMarks > 0) changes.push_back({Change::Entered, nullptr, nullptr, nullptr, nullptr, ""});
     }
 
     void exitScope(){
-        ScopeTable* parent = currentScope -> getParent();
-
-        if (parent == nullptr){
-            // need to sort out how we can print this to the file
-            if(outputStream != nullptr) {
-                *outputStream << "\tCannot exit the global scope\n";
-                outputStream -> flush();
+        if (scopes.size() == 1){
+            if constexpr (Logger::enabled) {
+                logger.log({TableOp::ExitGlobalRefused, scopes.back() -> getId(), 0, 0, nullptr, true});
             }
             return;
         }
-        delete currentScope;
-        currentScope = parent;
+        if (openMarks > 0){
+            // kept for a rollback
+            retiredBefore.push_back(retired);
+            retired += scopes.back() -> stats();
+            logScopeRemoved(scopes.size() - 1);
+            changes.push_back({Change::Exited, nullptr, std::move(scopes.back()), nullptr, nullptr, ""});
+            scopes.pop_back();
+            return;
+        }
+        logScopeRemoved(scopes.size() - 1);
+        if (reclaimer != nullptr)
+            reclaimer -> retire(std::move(scopes.back()), true);
+        else
+            retired += scopes.back() -> stats();
+        scopes.pop_back();
+        reclaimSome();
     }
 
     bool insert(const std::string& name, const std::string& type){
-        return currentScope -> insert(name, type);
+        reclaimSome();
+        bool inserted = writableScope() -> insert(name, type);
+        if (inserted && openMarks > 0) changes.push_back({Change::Inserted, nullptr, nullptr, nullptr, nullptr, name});
+        return inserted;
+    }
+
+    // A symbol typed by its attributes; see SymbolAttributes.
+    bool insert(const std::string& name, const SymbolAttributes& attributes){
+        reclaimSome();
+        bool inserted = writableScope() -> insert(name, attributes);
+        if (inserted && openMarks > 0) changes.push_back({Change::Inserted, nullptr, nullptr, nullptr, nullptr, name});
+        return inserted;
     }
 
     bool remove(const std::string& name){
-        return currentScope -> remove(name);
+        reclaimSome();
+        ScopeType* scope = writableScope();
+        if (openMarks == 0) return scope -> remove(name);
+        SymbolInfo* prev = nullptr;
+        SymbolInfo* symbol = scope -> detach(name, &prev);
+        if (symbol != nullptr) changes.push_back({Change::Removed, scope, nullptr, symbol, prev, ""});
+        return symbol != nullptr;
+    }
+
+    // Starts recording inserts, removes and scope entries and exits, so
+    // rollback can put the symbols and scopes back as they were here. Marks
+    // nest; each is closed by one rollback or commit, innermost first. With
+    // no mark open nothing is recorded.
+    Mark mark(){
+        return {changes.size(), openMarks++, nextId, generation};
+    }
+
+    // Whether m is still open: not closed yet, nor taken before clear() or
+    // on another table (a clone or fork starts with no marks).
+    bool isOpen(const Mark& m) const {
+        return m.generation == generation && m.level < openMarks;
+    }
+
+    // Undoes every change since m, newest first, in time proportional to
+    // their number, and closes m and any mark opened after it. Nothing is
+    // logged; counters keep the operations that were undone. Lookups made
+    // since may have reordered chains under a bucket policy, and that order
+    // is kept. A mark that is not open is refused: nothing changes and
+    // false is returned.
+    bool rollback(const Mark& m){
+        if (!isOpen(m)) return false;
+        while (changes.size() > m.changes){
+            undo(changes.back());
+            changes.pop_back();
+        }
+        nextId = m.nextId;
+        openMarks = m.level;
+        if (openMarks == 0) release();
+        return true;
+    }
+
+    // Keeps the changes since m and closes it (and any mark opened after
+    // it). An enclosing mark can still roll them back. Refuses a mark that
+    // is not open, as rollback does.
+    bool commit(const Mark& m){
+        if (!isOpen(m)) return false;
+        openMarks = m.level;
+        if (openMarks == 0) release();
+        return true;
     }
 
+    // Every scope shares num_buckets and the hash, so the name is hashed at
+    // most once, and not at all while small scopes settle the lookup from
+    // their tags. It is hashed one scope before the first that needs it, so
+    // that scope's slot is requested while this one is searched.
     SymbolInfo* lookup(const std::string& name){
-        ScopeTable* curr = currentScope;
+        unsigned long index = ScopeType::Unhashed;
+        counters.symbolLookups++;
 
-        while (curr != nullptr){
-            SymbolInfo* found = curr -> lookup(name);
+        for (size_t depth = scopes.size(); depth-- > 0;){
+            if (depth > 0){
+                if (index == ScopeType::Unhashed && !scopes[depth - 1] -> settlesUnhashed()) index = scopes[depth] -> bucketOf(name);
+                scopes[depth - 1] -> prefetchBucket(index);
+            }
+            counters.scopesVisited++;
+            SymbolInfo* found = lookupIn(depth, index, name);
             if (found != nullptr)
                 return found;
-            curr = curr -> getParent();    
         }
-        return nullptr;
+        return lookupBuiltin(name);
+    }
+
+    std::vector<bool> insertMany(const std::vector<std::pair<std::string, std::string>>& symbols){
+        reclaimSome();
+        std::vector<bool> inserted = writableScope() -> insertMany(symbols);
+        if (openMarks > 0){
+            for (size_t i = 0; i < symbols.size(); i++){
+                if (inserted[i]) changes.push_back({Change::Inserted, nullptr, nullptr, nullptr, nullptr, symbols[i].first});
+            }
+        }
+        return inserted;
+    }
+
+    // Same results and log lines as calling lookup on each name in order.
+    // Every scope shares num_buckets and the hash, so each name is hashed once.
+    std::vector<SymbolInfo*> lookupMany(const std::vector<std::string>& names){
+        std::vector<unsigned long> indexes(names.size());
+        for (size_t i = 0; i < names.size(); i++){
+            indexes[i] = scopes.back() -> bucketOf(names[i]);
+            for (auto& scope : scopes){
+                scope -> prefetchBucket(indexes[i]);
+            }
+        }
+        for (size_t i = 0; i < names.size(); i++){
+            scopes.back() -> prefetchHead(indexes[i]);
+        }
+
+        std::vector<SymbolInfo*> found(names.size(), nullptr);
+        counters.symbolLookups += names.size();
+        for (size_t i = 0; i < names.size(); i++){
+            for (size_t depth = scopes.size(); depth-- > 0 && found[i] == nullptr;){
+                counters.scopesVisited++;
+                found[i] = lookupIn(depth, indexes[i], names[i]);
+            }
+            if (found[i] == nullptr) found[i] = lookupBuiltin(names[i]);
+        }
+        return found;
     }
 
+    // Every visible symbol whose name starts with prefix, sorted by name; an
+    // inner declaration hides outer ones and builtins of the same name.
+    // Scopes built with ScopeConfig::prefixIndex answer in time proportional
+    // to their matches, others are scanned. Nothing is logged.
+    std::vector<SymbolInfo*> prefixLookup(const std::string& prefix){
+        std::map<std::string_view, SymbolInfo*> visible;
+        for (size_t depth = scopes.size(); depth-- > 0;){
+            scopes[depth] -> forEachWithPrefix(prefix, [&](SymbolInfo* symbol){
+                visible.emplace(symbol -> getName(), symbol);
+            });
+        }
+        for (uint32_t i = 0; i < config.builtins.size(); i++){
+            std::string_view name = config.builtins.symbols[i].name;
+            if (name.substr(0, prefix.size()) == prefix && visible.find(name) == visible.end()){
+                SymbolInfo* symbol = builtinSymbol(i);
+                visible.emplace(symbol -> getName(), symbol);
+            }
+        }
+
+        std::vector<SymbolInfo*> result;
+        result.reserve(visible.size());
+        for (const auto& entry : visible){
+            result.push_back(entry.second);
+        }
+        return result;
+    }
+
+    // Up to k visible symbols within budget edits of name, nearest first and
+    // by name among equals, for "did you mean" after a failed lookup. Only
+    // the innermost declaration of a name counts; builtins come last. Scopes
+    // built with ScopeConfig::suggestIndex search their letter-pair index,
+    // others are scanned. Nothing is logged.
+    std::vector<SymbolInfo*> suggest(const std::string& name, size_t k, int budget = 2){
+        std::map<std::string_view, std::pair<int, SymbolInfo*>> visible;
+        for (size_t depth = scopes.size(); depth-- > 0;){
+            scopes[depth] -> forEachNear(name, budget, [&](SymbolInfo* symbol, int distance){
+                visible.emplace(symbol -> getName(), std::make_pair(distance, symbol));
+            });
+        }
+        for (uint32_t i = 0; i < config.builtins.size(); i++){
+            std::string_view builtin = config.builtins.symbols[i].name;
+            if (visible.find(builtin) != visible.end()) continue;
+            int distance = editDistance(name, builtin, budget);
+            if (distance <= budget){
+                SymbolInfo* symbol = builtinSymbol(i);
+                visible.emplace(symbol -> getName(), std::make_pair(distance, symbol));
+            }
+        }
+
+        // map order is name order, so a stable sort by distance keeps names sorted
+        std::vector<std::pair<int, SymbolInfo*>> nearest;
+        for (const auto& entry : visible){
+            nearest.push_back(entry.second);
+        }
+        std::stable_sort(nearest.begin(), nearest.end(), [](const std::pair<int, SymbolInfo*>& a, const std::pair<int, SymbolInfo*>& b){
+            return a.first < b.first;
+        });
+
+        std::vector<SymbolInfo*> result;
+        for (size_t i = 0; i < nearest.size() && i < k; i++){
+            result.push_back(nearest[i].second);
+        }
+        return result;
+    }
+
+    // Printed to this table's stream, which a shared scope may not have.
     void printCurrentScope(){
-        currentScope->print("\t");
+        if (logger.stream() != nullptr) scopes.back()->print(*logger.stream(), "\t");
     }
     
     void printAllScope(){
-        ScopeTable* curr = currentScope;
+        if (logger.stream() == nullptr) return;
         std::string indent = "\t";
-        while (curr != nullptr) {
-            curr->print(indent);
+        for (size_t depth = scopes.size(); depth-- > 0;) {
+            scopes[depth]->print(*logger.stream(), indent);
             indent += "\t";
-            curr = curr->getParent();
         }
     }
 
-    double getRatio(){
-        int count = 0;
+    // Totals over every live scope, current one included, and the emptied
+    // scopes clear() keeps for reuse.
+    MemoryStats memoryStats(){
+        MemoryStats stats;
+        for (auto& scope : scopes){
+            stats += scope -> memoryStats();
+        }
+        for (auto& scope : spareScopes){
+            stats += scope -> memoryStats();
+        }
+        return stats;
+    }
 
-        ScopeTable* parent = currentScope -> getParent();
-        if (parent == nullptr){
-            return currentScope -> getCollisionsRato();
+    // Per-scope lookup counters and chain lengths summed over the live
+    // scopes, plus how many scopes each lookup searched.
+    ProbeStats probeStats(){
+        ProbeStats stats = counters;
+        for (auto& scope : scopes){
+            stats += scope -> probeStats();
         }
+        return stats;
+    }
 
-        ScopeTable* curr = currentScope;
-        double ratio = 0;
+    // Only the scopes still on the stack.
+    ScopeStats liveStats(){
+        ScopeStats stats;
+        for (auto& scope : scopes){
+            stats += scope -> stats();
+        }
+        stats.probes.symbolLookups = counters.symbolLookups;
+        stats.probes.scopesVisited = counters.scopesVisited;
+        return stats;
+    }
 
-        while (curr != nullptr){
-            ratio += curr -> getCollisionsRato();
-            curr = curr -> getParent();
-            count ++;
+    // Every scope this table has ever created, exited ones included. Waits
+    // for exited scopes still being reclaimed.
+    ScopeStats lifetimeStats(){
+        ScopeStats stats = liveStats();
+        stats += retired;
+        if (reclaimer != nullptr) stats += reclaimer -> stats();
+        return stats;
+    }
+
+    double getLifetimeRatio(){
+        return lifetimeStats().collisionRatio();
+    }
+
+    double getRatio(){
+        if (scopes.size() == 1){
+            return scopes.back() -> getCollisionsRato();
+        }
+
+        double ratio = 0;
+        for (size_t depth = scopes.size(); depth-- > 0;){
+            ratio += scopes[depth] -> getCollisionsRato();
         }
-        return ratio / count;
+        return ratio / scopes.size();
     }
 };
 
-std::ostream* SymbolTable::outputStream = nullptr;
+using SymbolTable = BasicSymbolTable<TextLogger>;
 
 #endif
\ No newline at end of file
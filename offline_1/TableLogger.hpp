@@ -0,0 +1,109 @@
+#ifndef TABLELOGGER_H
+#define TABLELOGGER_H
+
+#include <iostream>
+#include <string>
+
+// What ScopeTable and SymbolTable report about their work. Which logger a
+// table uses is a template parameter, so a table built with NullLogger has
+// every reporting branch compiled out; TextLogger writes the familiar log
+// lines, ObserverLogger hands each event to a TableObserver.
+
+enum class TableOp{
+    ScopeCreated,
+    ScopeRemoved,
+    Inserted,
+    Found,
+    Deleted,
+    ExitGlobalRefused,
+};
+
+struct TableEvent{
+    TableOp op;
+    int scopeId;
+    unsigned long bucket;    // 0-based
+    int position;            // 1-based place in the chain
+    const std::string* name; // for Inserted, Found and Deleted; nullptr otherwise
+    bool global;             // the scope has no parent
+};
+
+// The text format of the original tables, shared by TextLogger and TextObserver.
+inline void formatEvent(std::ostream& os, const TableEvent& event){
+    switch (event.op){
+        case TableOp::ScopeCreated:
+            os << "\tScopeTable# " << event.scopeId << " created\n";
+            os.flush();
+            break;
+        case TableOp::ScopeRemoved:
+            os << "\tScopeTable# " << event.scopeId << " removed";
+            if (!event.global) os << "\n"; // No newline for global scope
+            os.flush();
+            break;
+        case TableOp::Inserted:
+            os << "\tInserted in ScopeTable# " << event.scopeId << " at position "<<(event.bucket+1)<<", "<<event.position<<"\n";
+            break;
+        case TableOp::Found:
+            os <<"\t'"<<*event.name<<"'"<<" found in ScopeTable# "<< event.scopeId << " at position "<<(event.bucket+1)<<", "<< event.position<<"\n";
+            break;
+        case TableOp::Deleted:
+            os<<"\tDeleted "<<"'"<<*event.name<<"'"<<" from ScopeTable# "<< event.scopeId <<" at position "<<(event.bucket+1)<<", "<<event.position<<"\n";
+            break;
+        case TableOp::ExitGlobalRefused:
+            os << "\tCannot exit the global scope\n";
+            os.flush();
+            break;
+    }
+}
+
+class TableObserver{
+   public:
+    virtual ~TableObserver() {}
+    virtual void onEvent(const TableEvent& event) = 0;
+};
+
+// The text format as an observer, e.g. to tee it next to other observers.
+class TextObserver : public TableObserver{
+    std::ostream& os;
+
+   public:
+    TextObserver(std::ostream& out) : os(out) {}
+    void onEvent(const TableEvent& event) override { formatEvent(os, event); }
+};
+
+struct NullLogger{
+    static const bool enabled = false;
+
+    NullLogger(std::ostream*, TableObserver*) {}
+    void log(const TableEvent&) {}
+    bool active() const { return false; } // whether log() reaches anyone
+    std::ostream* stream() const { return nullptr; }
+    void setOutputStream(std::ostream*) {}
+};
+
+struct TextLogger{
+    static const bool enabled = true;
+    std::ostream* os;
+
+    TextLogger(std::ostream* out, TableObserver*) : os(out) {}
+    void log(const TableEvent& event){
+        if (os != nullptr) formatEvent(*os, event);
+    }
+    bool active() const { return os != nullptr; }
+    std::ostream* stream() const { return os; }
+    void setOutputStream(std::ostream* out) { os = out; }
+};
+
+struct ObserverLogger{
+    static const bool enabled = true;
+    TableObserver* observer;
+
+    ObserverLogger(std::ostream*, TableObserver* obs) : observer(obs) {}
+    void log(const TableEvent& event){
+        if (observer != nullptr) observer -> onEvent(event);
+    }
+    bool active() const { return observer != nullptr; }
+    std::ostream* stream() const { return nullptr; }
+    void setOutputStream(std::ostream*) {}
+};
+
+#endif
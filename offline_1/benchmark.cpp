@@ -0,0 +1,1212 @@
+#include <bits/stdc++.h>
+#include "ConcurrentSymbolTable.hpp"
+#include "ShardedScopeTable.hpp"
+#include "SymbolTable.hpp"
+#include "SymbolSnapshot.hpp"
+#include "SharedSymbolTable.hpp"
+#include <malloc.h>
+#include <sys/wait.h>
+#include "Hashfunctions.hpp"
+
+using namespace std;
+
+// helpers
+double elapsedSeconds(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+string symbolName(int i) {
+    return "sym" + to_string(i);
+}
+
+// One writer keeps inserting, removing and entering/exiting scopes while the
+// readers look up names as fast as they can. Every hit must carry the type
+// the writer gave that name, otherwise a reader saw a torn or freed node.
+void benchmarkConcurrent(int numBuckets, int numSymbols, int numReaders, ostream& report) {
+    ConcurrentSymbolTable st(numBuckets);
+    for (int i = 0; i < numSymbols; i++) {
+        st.insert(symbolName(i), "T" + to_string(i));
+    }
+
+    atomic<bool> done(false);
+    atomic<long long> totalLookups(0), totalHits(0), corrupted(0);
+
+    vector<thread> readers;
+    for (int r = 0; r < numReaders; r++) {
+        readers.emplace_back([&, r]() {
+            mt19937 rng(r + 1);
+            long long lookups = 0, hits = 0, bad = 0;
+            while (!done.load(memory_order_relaxed)) {
+                ConcurrentSymbolTable::ReadGuard guard(st);
+                for (int k = 0; k < 256; k++) {
+                    int i = rng() % (2 * numSymbols);
+                    const ConcurrentSymbolTable::Node* found = st.lookup(symbolName(i));
+                    lookups++;
+                    if (found != nullptr) {
+                        hits++;
+                        if (found->getName() != symbolName(i) || found->getType() != "T" + to_string(i)) bad++;
+                    }
+                }
+            }
+            totalLookups += lookups;
+            totalHits += hits;
+            corrupted += bad;
+        });
+    }
+
+    auto start = chrono::steady_clock::now();
+    long long writes = 0;
+    mt19937 rng(12345);
+    for (int round = 0; round < 20; round++) {
+        for (int depth = 0; depth < 8; depth++) {
+            st.enterScope();
+            for (int k = 0; k < numSymbols / 8; k++) {
+                int i = rng() % (2 * numSymbols);
+                st.insert(symbolName(i), "T" + to_string(i));
+                writes++;
+            }
+        }
+        for (int k = 0; k < numSymbols / 4; k++) {
+            st.remove(symbolName(rng() % (2 * numSymbols)));
+            writes++;
+        }
+        for (int depth = 0; depth < 8; depth++) {
+            st.exitScope();
+            writes++;
+        }
+    }
+    double writerTime = elapsedSeconds(start);
+    done = true;
+    for (auto& t : readers) t.join();
+    double totalTime = elapsedSeconds(start);
+    // readers are gone, so a couple of epoch bumps free everything
+    for (int i = 0; i < 3; i++) st.collect();
+
+    report << "Concurrent lookups (1 writer, " << numReaders << " readers)\n";
+    report << "----------------------------------------\n";
+    report << left << setw(24) << "Writer ops/sec" << fixed << setprecision(0) << writes / writerTime << "\n";
+    report << left << setw(24) << "Reader lookups/sec" << totalLookups / totalTime << "\n";
+    report << left << setw(24) << "Reader hit rate" << setprecision(4)
+           << (totalLookups ? (double)totalHits / totalLookups : 0.0) << "\n";
+    report << left << setw(24) << "Corrupted reads" << corrupted.load() << "\n";
+    report << left << setw(24) << "Still retired" << st.pendingRetired() << "\n\n";
+}
+
+// Threads insert into one shared global scope. Thread k owns the names with
+// index % t == k and also retries its neighbour's names, so half of all
+// attempts are duplicates; exactly numSymbols inserts must succeed.
+void benchmarkSharded(int numBuckets, int numSymbols, int maxThreads, ostream& report) {
+    vector<string> names;
+    for (int i = 0; i < numSymbols; i++) names.push_back(symbolName(i));
+
+    report << "Sharded global scope, " << numSymbols << " names, " << 2 * numSymbols << " inserts per run\n";
+    report << "----------------------------------------\n";
+    report << left << setw(10) << "Threads" << setw(10) << "Shards"
+           << setw(18) << "Inserts/sec" << setw(12) << "Speedup" << "Exact" << "\n";
+
+    for (int shardCount : {1, 64}) {
+        double baseline = 0;
+        for (int t = 1; t <= maxThreads; t++) {
+            ShardedScopeTable table(numBuckets, shardCount);
+            atomic<long long> inserted(0);
+
+            auto start = chrono::steady_clock::now();
+            vector<thread> workers;
+            for (int k = 0; k < t; k++) {
+                workers.emplace_back([&, k]() {
+                    long long ok = 0;
+                    for (int i = k; i < numSymbols; i += t) ok += table.insert(names[i], "ID");
+                    for (int i = (k + 1) % t; i < numSymbols; i += t) ok += table.insert(names[i], "ID");
+                    inserted += ok;
+                });
+            }
+            for (auto& w : workers) w.join();
+            double seconds = elapsedSeconds(start);
+
+            double rate = 2.0 * numSymbols / seconds;
+            if (t == 1) baseline = rate;
+            bool exact = inserted == numSymbols;
+            for (const string& name : names) {
+                string type;
+                exact = exact && table.lookup(name, [&](const SymbolInfo& symbol) { type = symbol.getType(); }) && type == "ID";
+            }
+            report << left << setw(10) << t << setw(10) << table.getNumShards()
+                   << setw(18) << fixed << setprecision(0) << rate
+                   << setw(12) << setprecision(2) << rate / baseline
+                   << (exact ? "yes" : "NO") << "\n";
+        }
+    }
+    report << "\n";
+}
+
+// Compares lookup one name at a time against lookupMany over the same
+// batches, and checks that both give the same symbols and the same log.
+void benchmarkBatch(int numBuckets, int numSymbols, ostream& report) {
+    const int batchSize = 64;
+    mt19937 rng(7);
+    vector<string> queries;
+    for (int i = 0; i < 8 * numSymbols; i++) queries.push_back(symbolName(rng() % (2 * numSymbols)));
+
+    SymbolTable st(numBuckets);
+    vector<pair<string, string>> symbols;
+    for (int i = 0; i < numSymbols; i++) symbols.push_back({symbolName(i), "ID"});
+    st.insertMany(symbols);
+    st.enterScope();
+
+    auto start = chrono::steady_clock::now();
+    long long hitsOne = 0;
+    for (const string& q : queries) hitsOne += st.lookup(q) != nullptr;
+    double oneTime = elapsedSeconds(start);
+
+    start = chrono::steady_clock::now();
+    long long hitsMany = 0;
+    for (size_t i = 0; i < queries.size(); i += batchSize) {
+        vector<string> batch(queries.begin() + i, queries.begin() + min(queries.size(), i + batchSize));
+        for (SymbolInfo* found : st.lookupMany(batch)) hitsMany += found != nullptr;
+    }
+    double manyTime = elapsedSeconds(start);
+
+    // same log, line for line
+    ostringstream logOne, logMany;
+    vector<string> sample(queries.begin(), queries.begin() + min<size_t>(queries.size(), 1000));
+    st.setOutputStream(&logOne);
+    for (const string& q : sample) st.lookup(q);
+    st.setOutputStream(&logMany);
+    st.lookupMany(sample);
+    st.setOutputStream(nullptr);
+
+    report << "Batched lookups, " << numSymbols << " symbols, batches of " << batchSize << "\n";
+    report << "----------------------------------------\n";
+    report << left << setw(24) << "lookup/sec" << fixed << setprecision(0) << queries.size() / oneTime << "\n";
+    report << left << setw(24) << "lookupMany/sec" << queries.size() / manyTime << "\n";
+    report << left << setw(24) << "Same results" << (hitsOne == hitsMany ? "yes" : "NO") << "\n";
+    report << left << setw(24) << "Same log" << (logOne.str() == logMany.str() ? "yes" : "NO") << "\n\n";
+}
+
+// Replays an offline_1 style command script (I/D/S/E lines) into a table.
+void replayScript(const string& script, SymbolTable& st) {
+    istringstream in(script);
+    string line;
+    getline(in, line); // bucket count
+    while (getline(in, line)) {
+        istringstream ss(line);
+        string cmd, name, type;
+        ss >> cmd;
+        if (cmd == "I") {
+            ss >> name;
+            getline(ss, type);
+            st.insert(name, type.empty() ? type : type.substr(1));
+        }
+        else if (cmd == "D") { ss >> name; st.remove(name); }
+        else if (cmd == "S") st.enterScope();
+        else if (cmd == "E") st.exitScope();
+    }
+}
+
+string capture(SymbolTable& st, void (SymbolTable::*print)()) {
+    ostringstream out;
+    st.setOutputStream(&out);
+    (st.*print)();
+    st.setOutputStream(nullptr);
+    return out.str();
+}
+
+// Startup cost of rebuilding a big global scope from its command script
+// versus mapping a saved snapshot, plus a round trip check: every name,
+// builtins included, must resolve the same way (log line included) in the
+// image, after the first mutation (which promotes only the current scope)
+// and in the fully promoted table.
+void benchmarkSnapshot(int numBuckets, int numSymbols, ostream& report) {
+    string script = to_string(numBuckets) + "\n";
+    for (int i = 0; i < numSymbols; i++) {
+        if (i == numSymbols - numSymbols / 10) script += "S\n";
+        script += "I " + symbolName(i) + " FUNCTION,INT<==(INT,FLOAT)\n";
+        if (i % 97 == 0) script += "D " + symbolName(i / 2) + "\n";
+    }
+    string path = "snapshot_bench.bin";
+
+    auto start = chrono::steady_clock::now();
+    SymbolTable original(numBuckets);
+    replayScript(script, original);
+    double replayTime = elapsedSeconds(start);
+
+    start = chrono::steady_clock::now();
+    bool saved = saveSnapshot(original, path);
+    double saveTime = elapsedSeconds(start);
+
+    start = chrono::steady_clock::now();
+    MappedSymbolTable mapped;
+    bool loaded = mapped.load(path);
+    double loadTime = elapsedSeconds(start);
+
+    long long mismatches = 0;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < numSymbols + 100; i++) {
+        SymbolInfo* want = original.lookup(symbolName(i));
+        SymbolRef got = mapped.lookup(symbolName(i));
+        if ((want == nullptr) != !got) mismatches++;
+        else if (want != nullptr && (got.name != want->getName() || got.type != want->getType())) mismatches++;
+    }
+    double lookupTime = elapsedSeconds(start);
+
+    ostringstream logOriginal, logMapped; // outlive the tables, which log their removal
+    ScopeConfig config;
+    config.builtins = C_BUILTINS.view();
+    SymbolTable withBuiltins(numBuckets, config);
+    replayScript(script, withBuiltins);
+    config.os = &logMapped;
+    MappedSymbolTable logged(config);
+    logged.load(path);
+    withBuiltins.setOutputStream(&logOriginal);
+    auto compareLogs = [&]() {
+        for (int i = 0; i < numSymbols; i += 7) {
+            withBuiltins.lookup(symbolName(i));
+            logged.lookup(symbolName(i));
+        }
+        for (const char* name : {"printf", "malloc", "promoted", "nowhere"}) {
+            withBuiltins.lookup(name);
+            logged.lookup(name);
+        }
+        if (logOriginal.str() != logMapped.str()) mismatches++;
+    };
+    compareLogs();
+
+    start = chrono::steady_clock::now();
+    logged.insert("promoted", "INT");
+    double promoteTime = elapsedSeconds(start);
+    withBuiltins.insert("promoted", "INT");
+    if (!logged.isPromoted() || logged.mappedScopes() != withBuiltins.getDepth()) mismatches++;
+    compareLogs();
+    logged.exitScope();
+    withBuiltins.exitScope();
+    compareLogs();
+
+    mapped.insert("promoted", "INT");
+    original.insert("promoted", "INT");
+    if (capture(original, &SymbolTable::printAllScope) != capture(mapped.table(), &SymbolTable::printAllScope)) mismatches++;
+    if (mapped.mappedScopes() != 0) mismatches++;
+    remove(path.c_str());
+
+    report << "Snapshot startup, " << numSymbols << " symbols\n";
+    report << "----------------------------------------\n";
+    report << left << setw(24) << "Replay script (ms)" << fixed << setprecision(3) << replayTime * 1000 << "\n";
+    report << left << setw(24) << "Save snapshot (ms)" << saveTime * 1000 << "\n";
+    report << left << setw(24) << "Map snapshot (ms)" << loadTime * 1000 << "\n";
+    report << left << setw(24) << "Lookup check (ms)" << lookupTime * 1000 << "\n";
+    report << left << setw(24) << "First insert (ms)" << promoteTime * 1000 << "\n";
+    report << left << setw(24) << "Round trip" << (saved && loaded && mismatches == 0 ? "ok" : "FAILED") << "\n\n";
+}
+
+// One process publishes a global scope into shared memory, then several
+// child processes attach and resolve every name in place. A reader asking
+// for an older version stamp must be refused.
+void benchmarkShared(int numBuckets, int numSymbols, int numProcesses, ostream& report) {
+    const string segment = "/symtab_bench_" + to_string(getpid());
+    const uint64_t version = 2;
+
+    SymbolTable st(numBuckets);
+    for (int i = 0; i < numSymbols; i++) st.insert(symbolName(i), "T" + to_string(i));
+
+    auto start = chrono::steady_clock::now();
+    bool published = SharedSymbolTable::publish(st, segment, version);
+    double publishTime = elapsedSeconds(start);
+
+    SharedSymbolTable stale;
+    bool staleRejected = !stale.attach(segment, version - 1);
+
+    start = chrono::steady_clock::now();
+    vector<pid_t> children;
+    for (int p = 0; p < numProcesses; p++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            SharedSymbolTable shared;
+            if (!shared.attach(segment, version)) _exit(2);
+            for (int i = 0; i < 2 * numSymbols; i++) {
+                SymbolRef found = shared.lookup(symbolName(i));
+                if (bool(found) != (i < numSymbols)) _exit(1);
+                if (found && found.type != "T" + to_string(i)) _exit(1);
+            }
+            _exit(0);
+        }
+        children.push_back(pid);
+    }
+    int failed = 0;
+    for (pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed++;
+    }
+    double readTime = elapsedSeconds(start);
+    SharedSymbolTable::unpublish(segment);
+
+    report << "Shared-memory table, " << numSymbols << " symbols, " << numProcesses << " reader processes\n";
+    report << "----------------------------------------\n";
+    report << left << setw(24) << "Publish (ms)" << fixed << setprecision(3) << publishTime * 1000 << "\n";
+    report << left << setw(24) << "Readers done (ms)" << readTime * 1000 << "\n";
+    report << left << setw(24) << "Stale version refused" << (staleRejected ? "yes" : "NO") << "\n";
+    report << left << setw(24) << "Readers failed" << (published ? failed : numProcesses) << "\n\n";
+}
+
+// Counts events by kind; stands in for a tool that wants structured events.
+class CountingObserver : public TableObserver {
+   public:
+    long long counts[6] = {};
+    void onEvent(const TableEvent& event) override { counts[(int) event.op]++; }
+};
+
+// Runs one insert/lookup/remove/scope trace; returns the number of hits.
+template <class Logger>
+long long runTrace(BasicSymbolTable<Logger>& st, const vector<string>& names, int rounds) {
+    long long hits = 0;
+    for (int r = 0; r < rounds; r++) {
+        st.enterScope();
+        for (const string& name : names) st.insert(name, "ID");
+        for (const string& name : names) hits += st.lookup(name) != nullptr;
+        for (size_t i = 0; i < names.size(); i += 2) st.remove(names[i]);
+        st.exitScope();
+    }
+    return hits;
+}
+
+template <class Logger>
+double timeTrace(const ScopeConfig& config, int numBuckets, const vector<string>& names, int rounds, long long& hits) {
+    BasicSymbolTable<Logger> st(numBuckets, config);
+    auto start = chrono::steady_clock::now();
+    hits = runTrace(st, names, rounds);
+    return elapsedSeconds(start);
+}
+
+// What logging costs: compiled out, switched off at run time, formatted
+// into a sink, and handed to an observer. The observer must see exactly the
+// events the text log shows.
+void benchmarkLogging(int numBuckets, int numSymbols, ostream& report) {
+    const int rounds = 20;
+    vector<string> names;
+    for (int i = 0; i < numSymbols; i++) names.push_back(symbolName(i));
+    long long ops = (long long) rounds * (numSymbols + numSymbols + (numSymbols + 1) / 2);
+
+    ScopeConfig config;
+    long long nullHits, offHits, textHits, observerHits;
+    double nullTime = timeTrace<NullLogger>(config, numBuckets, names, rounds, nullHits);
+    double offTime = timeTrace<TextLogger>(config, numBuckets, names, rounds, offHits);
+
+    ostringstream sink;
+    config.os = &sink;
+    double textTime = timeTrace<TextLogger>(config, numBuckets, names, rounds, textHits);
+
+    CountingObserver counter;
+    config.os = nullptr;
+    config.observer = &counter;
+    double observerTime = timeTrace<ObserverLogger>(config, numBuckets, names, rounds, observerHits);
+
+    // one event per log line; the last line, the global scope's "removed",
+    // has no newline
+    long long events = 0;
+    for (long long n : counter.counts) events += n;
+    string text = sink.str();
+    long long lines = count(text.begin(), text.end(), '\n') + 1;
+    bool sameHits = nullHits == offHits && offHits == textHits && textHits == observerHits;
+
+    report << "Logging policies, " << numSymbols << " symbols, " << rounds << " rounds\n";
+    report << "----------------------------------------\n";
+    report << left << setw(24) << "NullLogger ops/sec" << fixed << setprecision(0) << ops / nullTime << "\n";
+    report << left << setw(24) << "Text, no stream" << ops / offTime << "\n";
+    report << left << setw(24) << "Text, to a sink" << ops / textTime << "\n";
+    report << left << setw(24) << "Observer ops/sec" << ops / observerTime << "\n";
+    report << left << setw(24) << "Same results" << (sameHits ? "yes" : "NO") << "\n";
+    report << left << setw(24) << "Events match log" << (events == lines ? "yes" : "NO") << "\n\n";
+}
+
+// Skewed lookups: rank r is asked for with probability proportional to
+// 1/r^skew. Names are inserted in a shuffled order, so a hot name is as
+// likely to sit at the tail of its chain as at the head.
+void benchmarkZipf(int numBuckets, int numSymbols, ostream& report) {
+    const double skew = 1.0;
+    const int numLookups = 20 * numSymbols;
+    mt19937 rng(11);
+
+    vector<string> names;
+    for (int i = 0; i < numSymbols; i++) names.push_back(symbolName(i));
+    vector<string> inserted = names;
+    shuffle(inserted.begin(), inserted.end(), rng);
+
+    vector<double> weights(numSymbols);
+    for (int r = 0; r < numSymbols; r++) weights[r] = 1.0 / pow(r + 1, skew);
+    discrete_distribution<int> rank(weights.begin(), weights.end());
+    vector<string> trace;
+    for (int i = 0; i < numLookups; i++) trace.push_back(names[rank(rng)]);
+
+    report << "Zipf lookups, " << numSymbols << " symbols, " << numBuckets << " buckets, skew " << skew << ", treeify off\n";
+    report << "----------------------------------------\n";
+    report << left << setw(18) << "Policy" << setw(16) << "lookups/sec" << setw(16) << "probes/hit" << "moves\n";
+
+    const pair<const char*, BucketPolicy> policies[] = {
+        {"insertion", BucketPolicy::InsertionOrder},
+        {"move-to-front", BucketPolicy::MoveToFront},
+        {"transpose", BucketPolicy::Transpose},
+    };
+    for (const auto& policy : policies) {
+        ScopeConfig config;
+        config.bucketPolicy = policy.second;
+        config.treeifyThreshold = 0; // a tree bucket ignores the policy
+        BasicSymbolTable<NullLogger> st(numBuckets, config);
+        for (const string& name : inserted) st.insert(name, "ID");
+
+        auto start = chrono::steady_clock::now();
+        long long hits = 0;
+        for (const string& name : trace) hits += st.lookup(name) != nullptr;
+        double seconds = elapsedSeconds(start);
+
+        ProbeStats stats = st.probeStats();
+        report << left << setw(18) << policy.first << fixed << setprecision(0) << setw(16) << trace.size() / seconds
+               << setprecision(3) << setw(16) << stats.probesPerHit() << stats.moves
+               << (hits == numLookups ? "" : "  MISSED") << "\n";
+    }
+    report << "\n";
+}
+
+// Every name lands in bucket 0, as with a hash an attacker has worked out.
+unsigned long collidingHash(const string&, int) {
+    return 0;
+}
+
+// Lookup latency percentiles in nanoseconds, one timing per call.
+template <class Logger>
+vector<double> lookupLatencies(BasicSymbolTable<Logger>& st, const vector<string>& queries) {
+    vector<double> latencies;
+    latencies.reserve(queries.size());
+    for (const string& q : queries) {
+        auto start = chrono::steady_clock::now();
+        st.lookup(q);
+        latencies.push_back(elapsedSeconds(start) * 1e9);
+    }
+    sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+// Worst case of one overfull bucket, as a chain and as a tree, plus a check
+// that treeifying (and falling back once the bucket shrinks) changes
+// nothing in the log or the printout.
+void benchmarkTreeify(int numBuckets, int numSymbols, ostream& report) {
+    mt19937 rng(13);
+    vector<string> queries;
+    for (int i = 0; i < 4 * numSymbols; i++) queries.push_back(symbolName(rng() % (2 * numSymbols)));
+
+    report << "Single bucket worst case, " << numSymbols << " symbols\n";
+    report << "----------------------------------------\n";
+    report << left << setw(18) << "Bucket" << setw(12) << "p50 ns" << setw(12) << "p99 ns" << "max ns\n";
+    for (int threshold : {0, 64}) {
+        ScopeConfig config;
+        config.hashfunc = collidingHash;
+        config.treeifyThreshold = threshold;
+        BasicSymbolTable<NullLogger> st(numBuckets, config);
+        for (int i = 0; i < numSymbols; i++) st.insert(symbolName(i), "ID");
+        vector<double> latencies = lookupLatencies(st, queries);
+        report << left << setw(18) << (threshold == 0 ? "chain" : "tree") << fixed << setprecision(0)
+               << setw(12) << latencies[latencies.size() / 2] << setw(12) << latencies[latencies.size() * 99 / 100]
+               << latencies.back() << "\n";
+    }
+
+    // grow past the threshold, shrink below half of it, grow again; every
+    // name is inserted twice, so duplicates count towards the collisions
+    vector<string> logs, prints;
+    vector<double> ratios;
+    for (int threshold : {0, 16}) {
+        ScopeConfig config;
+        config.treeifyThreshold = threshold;
+        ostringstream log;
+        config.os = &log;
+        SymbolTable st(numBuckets, config);
+        mt19937 removals(17);
+        for (int round = 0; round < 3; round++) {
+            for (int pass = 0; pass < 2; pass++) {
+                for (int i = 0; i < numSymbols; i++) st.insert(symbolName(i), "ID");
+            }
+            for (const string& q : queries) st.lookup(q);
+            for (int i = 0; i < numSymbols; i++) if (removals() % 4 != 0) st.remove(symbolName(i));
+        }
+        ratios.push_back(st.getRatio());
+        logs.push_back(log.str());
+        prints.push_back(capture(st, &SymbolTable::printAllScope));
+        st.setOutputStream(nullptr);
+    }
+    report << left << setw(18) << "Same log" << (logs[0] == logs[1] ? "yes" : "NO") << "\n";
+    report << left << setw(18) << "Same print" << (prints[0] == prints[1] ? "yes" : "NO") << "\n";
+    report << left << setw(18) << "Same ratio" << (ratios[0] == ratios[1] ? "yes" : "NO") << "\n\n";
+}
+
+// Completion queries over a big global scope and a few nested ones that
+// shadow some of its names. Indexed and scanning tables must agree on the
+// answer, names and types alike.
+void benchmarkPrefix(int numBuckets, int numSymbols, ostream& report) {
+    const int depth = 4;
+    mt19937 rng(19);
+    vector<string> prefixes;
+    for (int i = 0; i < 200; i++) {
+        string name = symbolName(rng() % numSymbols);
+        prefixes.push_back(name.substr(0, name.size() - rng() % 3));
+    }
+
+    vector<vector<string>> answers;
+    report << "Prefix queries, " << numSymbols << " globals, " << depth << " nested scopes\n";
+    report << "----------------------------------------\n";
+    for (bool indexed : {false, true}) {
+        ScopeConfig config;
+        config.prefixIndex = indexed;
+        config.builtins = C_BUILTINS.view();
+        BasicSymbolTable<NullLogger> st(numBuckets, config);
+        mt19937 shadows(23);
+        for (int i = 0; i < numSymbols; i++) st.insert(symbolName(i), "GLOBAL");
+        for (int d = 1; d <= depth; d++) {
+            st.enterScope();
+            for (int i = 0; i < numSymbols / 100; i++) st.insert(symbolName(shadows() % numSymbols), "LOCAL" + to_string(d));
+        }
+
+        vector<string> answer;
+        long long matches = 0;
+        auto start = chrono::steady_clock::now();
+        for (const string& prefix : prefixes) {
+            vector<SymbolInfo*> found = st.prefixLookup(prefix);
+            matches += found.size();
+            for (SymbolInfo* symbol : found) answer.push_back(symbol -> getName() + ":" + symbol -> getType());
+        }
+        double seconds = elapsedSeconds(start);
+        answers.push_back(answer);
+        report << left << setw(24) << (indexed ? "Indexed queries/sec" : "Scanned queries/sec") << fixed
+               << setprecision(0) << prefixes.size() / seconds << "\n";
+        if (indexed) report << left << setw(24) << "Matches per query" << setprecision(1) << matches / (prefixes.size() * 1.0) << "\n";
+    }
+    report << left << setw(24) << "Same answers" << (answers[0] == answers[1] ? "yes" : "NO") << "\n\n";
+}
+
+// A lowercase identifier of 6 to 12 letters.
+string identifierName(mt19937& rng) {
+    string name(6 + rng() % 7, 'a');
+    for (char& c : name) c = 'a' + rng() % 26;
+    return name;
+}
+
+// "Did you mean" latency on a big global scope under a small one, with
+// misspelt names as queries. Indexed and scanning tables must suggest the
+// same names.
+void benchmarkSuggest(int numBuckets, int numSymbols, ostream& report) {
+    const size_t k = 5;
+    mt19937 rng(29);
+    vector<string> names;
+    for (int i = 0; i < numSymbols; i++) names.push_back(identifierName(rng));
+    vector<string> queries;
+    for (int i = 0; i < 200; i++) {
+        string query = names[rng() % names.size()];
+        size_t at = rng() % query.size();
+        if (rng() % 2) query[at] = 'a' + rng() % 26;
+        else query.erase(at, 1);
+        queries.push_back(query);
+    }
+
+    vector<vector<string>> answers;
+    report << "Suggestions, " << numSymbols << " globals, top " << k << " within 2 edits\n";
+    report << "----------------------------------------\n";
+    report << left << setw(12) << "Scopes" << setw(14) << "mean us" << setw(14) << "p99 us" << "suggested\n";
+    for (bool indexed : {false, true}) {
+        ScopeConfig config;
+        config.suggestIndex = indexed;
+        BasicSymbolTable<NullLogger> st(numBuckets, config);
+        for (const string& name : names) st.insert(name, "GLOBAL");
+        st.enterScope();
+        for (int i = 0; i < 50; i++) st.insert(names[i], "LOCAL");
+
+        vector<string> answer;
+        vector<double> latencies;
+        long long suggested = 0;
+        for (const string& query : queries) {
+            auto start = chrono::steady_clock::now();
+            vector<SymbolInfo*> found = st.suggest(query, k);
+            latencies.push_back(elapsedSeconds(start) * 1e6);
+            suggested += found.size();
+            for (SymbolInfo* symbol : found) answer.push_back(symbol -> getName() + ":" + symbol -> getType());
+        }
+        answers.push_back(answer);
+        sort(latencies.begin(), latencies.end());
+        double mean = accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+        report << left << setw(12) << (indexed ? "indexed" : "scanned") << fixed << setprecision(1) << setw(14) << mean
+               << setw(14) << latencies[latencies.size() * 99 / 100] << suggested << "\n";
+    }
+    report << left << setw(12) << "Same answers " << (answers[0] == answers[1] ? "yes" : "NO") << "\n\n";
+}
+
+// Lookups that fall through a deep scope stack to the global scope: the
+// display walk of SymbolTable::lookup against chasing parent pointers and
+// hashing again in every scope.
+void benchmarkDepth(int numBuckets, int numSymbols, ostream& report) {
+    const int depth = 64;
+    ScopeConfig config;
+    BasicSymbolTable<NullLogger> st(numBuckets, config);
+    for (int i = 0; i < numSymbols; i++) st.insert(symbolName(i), "GLOBAL");
+    for (int d = 1; d < depth; d++) {
+        st.enterScope();
+        for (int i = 0; i < 8; i++) st.insert("local" + to_string(d) + "_" + to_string(i), "LOCAL");
+    }
+
+    mt19937 rng(31);
+    vector<string> queries;
+    for (int i = 0; i < 200000; i++) queries.push_back(symbolName(rng() % numSymbols));
+
+    auto start = chrono::steady_clock::now();
+    long long hitsDisplay = 0;
+    for (const string& q : queries) hitsDisplay += st.lookup(q) != nullptr;
+    double displayTime = elapsedSeconds(start);
+
+    start = chrono::steady_clock::now();
+    long long hitsChain = 0;
+    for (const string& q : queries) {
+        for (auto* scope = st.getCurrentScope(); scope != nullptr; scope = scope -> getParent()) {
+            if (scope -> lookup(q) != nullptr) { hitsChain++; break; }
+        }
+    }
+    double chainTime = elapsedSeconds(start);
+
+    report << "Lookups through " << depth << " scopes, " << numSymbols << " globals\n";
+    report << "----------------------------------------\n";
+    report << left << setw(24) << "Display lookups/sec" << fixed << setprecision(0) << queries.size() / displayTime << "\n";
+    report << left << setw(24) << "Parent walk lookups/sec" << queries.size() / chainTime << "\n";
+    report << left << setw(24) << "Global at depth 0" << (st.getScope(0) -> getParent() == nullptr ? "yes" : "NO") << "\n";
+    report << left << setw(24) << "Same results" << (hitsDisplay == hitsChain ? "yes" : "NO") << "\n\n";
+}
+
+// Read-mostly global scope, frozen against as built: lookup throughput on
+// a mix of hits and misses, the same log for both, and a thaw on the first
+// insert after which lookups still find everything.
+void benchmarkFreeze(int numBuckets, int numSymbols, ostream& report) {
+    mt19937 rng(37);
+    vector<string> queries;
+    for (int i = 0; i < 20 * numSymbols; i++) queries.push_back(symbolName(rng() % (numSymbols + numSymbols / 4)));
+
+    report << "Frozen global scope, " << numSymbols << " symbols, " << numBuckets << " buckets\n";
+    report << "----------------------------------------\n";
+    vector<string> logs;
+    for (bool freeze : {false, true}) {
+        ScopeConfig config;
+        BasicSymbolTable<NullLogger> st(numBuckets, config);
+        for (int i = 0; i < numSymbols; i++) st.insert(symbolName(i), "GLOBAL");
+        auto start = chrono::steady_clock::now();
+        bool frozen = freeze && st.getScope(0) -> freeze();
+        double freezeTime = elapsedSeconds(start);
+
+        start = chrono::steady_clock::now();
+        long long hits = 0;
+        for (const string& q : queries) hits += st.lookup(q) != nullptr;
+        double seconds = elapsedSeconds(start);
+        report << left << setw(24) << (freeze ? "Frozen lookups/sec" : "Chained lookups/sec") << fixed << setprecision(0)
+               << queries.size() / seconds << "\n";
+        if (freeze) {
+            report << left << setw(24) << "Freeze (ms)" << setprecision(3) << freezeTime * 1000 << "\n";
+            report << left << setw(24) << "Frozen" << (frozen ? "yes" : "NO") << "\n";
+        }
+
+        SymbolTable text(numBuckets);
+        for (int i = 0; i < numSymbols; i++) text.insert(symbolName(i), "GLOBAL");
+        if (freeze) text.getScope(0) -> freeze();
+        ostringstream log;
+        text.setOutputStream(&log);
+        for (size_t i = 0; i < 2000 && i < queries.size(); i++) text.lookup(queries[i]);
+        text.setOutputStream(nullptr);
+        logs.push_back(log.str());
+        if (freeze) {
+            text.insert("late", "GLOBAL");
+            bool thawed = !text.getScope(0) -> isFrozen();
+            long long found = 0;
+            for (int i = 0; i < numSymbols; i++) found += text.lookup(symbolName(i)) != nullptr;
+            report << left << setw(24) << "Thawed by insert" << (thawed && found == numSymbols ? "yes" : "NO") << "\n";
+        }
+    }
+    report << left << setw(24) << "Same log" << (logs[0] == logs[1] ? "yes" : "NO") << "\n\n";
+}
+
+// Random inserts, removes and scope changes after a mark, then a rollback.
+// The table must print exactly as it did at the mark, a symbol removed and
+// restored must keep its address, and the rollback time must follow the
+// number of changes rather than the size of the table. A mark already
+// closed, taken on another table or taken before clear() is refused.
+void applyChanges(SymbolTable& st, mt19937& rng, int count, int numSymbols) {
+    for (int i = 0; i < count; i++) {
+        int op = rng() % 8;
+        if (op == 0) st.enterScope();
+        else if (op == 1) st.exitScope();
+        else if (op < 5) st.insert(symbolName(rng() % (2 * numSymbols)), "LOCAL");
+        else st.remove(symbolName(rng() % (2 * numSymbols)));
+    }
+}
+
+string printed(SymbolTable& st) {
+    ostringstream out;
+    st.setOutputStream(&out);
+    st.printAllScope();
+    st.setOutputStream(nullptr);
+    return out.str();
+}
+
+void benchmarkRollback(int numBuckets, int numSymbols, ostream& report) {
+    report << "Rollback, " << numSymbols << " symbols, " << numBuckets << " buckets\n";
+    report << "----------------------------------------\n";
+    ScopeConfig config;
+    config.prefixIndex = true;
+    config.suggestIndex = true;
+    SymbolTable st(numBuckets, config);
+    for (int i = 0; i < numSymbols; i++) st.insert(symbolName(i), "GLOBAL");
+    st.enterScope();
+    for (int i = 0; i < numSymbols / 4; i++) st.insert(symbolName(2 * i), "LOCAL");
+
+    mt19937 rng(41);
+    bool same = true;
+    for (int count : {10, 100, 1000, 10000}) {
+        string before = printed(st);
+        size_t depth = st.getDepth();
+        SymbolInfo* kept = st.lookup(symbolName(1));
+
+        SymbolTable::Mark outer = st.mark();
+        applyChanges(st, rng, count / 2, numSymbols);
+        SymbolTable::Mark inner = st.mark();
+        applyChanges(st, rng, count / 2, numSymbols);
+        bool closed = st.commit(inner);
+        st.remove(symbolName(1));
+
+        auto start = chrono::steady_clock::now();
+        closed = st.rollback(outer) && closed;
+        double seconds = elapsedSeconds(start);
+
+        same = same && closed && printed(st) == before && st.getDepth() == depth && st.lookup(symbolName(1)) == kept
+               && st.prefixLookup(symbolName(1)).size() > 0 && st.suggest(symbolName(1), 1).size() == 1;
+        report << left << setw(24) << ("Rollback " + to_string(count) + " (us)") << fixed << setprecision(1)
+               << seconds * 1e6 << "\n";
+    }
+    report << left << setw(24) << "Restored exactly" << (same ? "yes" : "NO") << "\n";
+
+    SymbolTable::Mark outer = st.mark();
+    SymbolTable::Mark inner = st.mark();
+    bool refused = st.rollback(outer) && !st.rollback(inner) && !st.commit(outer);
+    SymbolTable::Mark kept = st.mark();
+    SymbolTable copy = st.clone();
+    refused = refused && !copy.rollback(kept) && !copy.commit(kept);
+    st.clear();
+    refused = refused && !st.rollback(kept) && !st.commit(kept);
+    report << left << setw(24) << "Stale marks refused" << (refused ? "yes" : "NO") << "\n\n";
+}
+
+// Many forks of one populated table, each making a few changes of its own.
+// Heap in use is read from malloc before and after, against tables filled
+// from scratch (a tenth as many are built and the figure scaled). Every fork
+// must see its own changes and nobody else's, also on separate threads.
+size_t heapInUse() {
+    return mallinfo2().uordblks;
+}
+
+// With the prefix and suggest indexes on, a fork reads its base's indexes
+// until its first change, and each fork's own names must show up in its
+// prefix queries only.
+void benchmarkForks(int numBuckets, int numSymbols, int numThreads, const ScopeConfig& config, ostream& report) {
+    const int numForks = 1000, changes = 8;
+    bool indexes = config.prefixIndex;
+    report << "Fork, " << numSymbols << " symbols, " << numBuckets << " buckets, " << numForks << " forks, indexes "
+           << (indexes ? "on" : "off") << "\n";
+    report << "----------------------------------------\n";
+    SymbolTable st(numBuckets, config);
+    for (int i = 0; i < numSymbols; i++) st.insert(symbolName(i), "GLOBAL");
+    st.enterScope();
+    for (int i = 0; i < numSymbols / 10; i++) st.insert(symbolName(i), "LOCAL");
+    string before = printed(st);
+
+    size_t heap = heapInUse();
+    auto start = chrono::steady_clock::now();
+    vector<unique_ptr<SymbolTable>> forks;
+    for (int f = 0; f < numForks; f++) forks.push_back(make_unique<SymbolTable>(st.fork()));
+    double forkTime = elapsedSeconds(start);
+    size_t forkBytes = heapInUse() - heap;
+
+    // each fork changes a few names in both scopes, on its own thread share
+    atomic<bool> isolated(true);
+    vector<thread> workers;
+    for (int t = 0; t < numThreads; t++) {
+        workers.emplace_back([&, t]() {
+            for (int f = t; f < numForks; f += numThreads) {
+                SymbolTable& fork = *forks[f];
+                string mine = "fork" + to_string(f) + "_";
+                for (int c = 0; c < changes; c++) fork.insert(mine + to_string(c), "LOCAL");
+                fork.remove(symbolName(f % (numSymbols / 10)));
+                for (int c = 0; c < changes; c++) {
+                    if (fork.lookup(mine + to_string(c)) == nullptr) isolated = false;
+                    if (fork.lookup("fork" + to_string((f + 1) % numForks) + "_" + to_string(c)) != nullptr) isolated = false;
+                    if (fork.lookup(symbolName((f * 7 + c) % numSymbols)) == nullptr) isolated = false;
+                }
+                if (indexes && fork.prefixLookup(mine).size() != (size_t) changes) isolated = false;
+            }
+        });
+    }
+    for (thread& worker : workers) worker.join();
+    size_t changedBytes = heapInUse() - heap;
+
+    size_t fullBytes;
+    double fullTime;
+    {
+        size_t fullHeap = heapInUse();
+        auto fullStart = chrono::steady_clock::now();
+        vector<unique_ptr<SymbolTable>> copies;
+        for (int f = 0; f < numForks / 10; f++) {
+            copies.push_back(make_unique<SymbolTable>(numBuckets, config));
+            for (int i = 0; i < numSymbols; i++) copies.back() -> insert(symbolName(i), "GLOBAL");
+            copies.back() -> enterScope();
+            for (int i = 0; i < numSymbols / 10; i++) copies.back() -> insert(symbolName(i), "LOCAL");
+        }
+        fullTime = elapsedSeconds(fullStart) * 10;
+        fullBytes = (heapInUse() - fullHeap) * 10;
+    }
+
+    report << left << setw(28) << "Fork (us each)" << fixed << setprecision(2) << forkTime * 1e6 / numForks << "\n";
+    report << left << setw(28) << "Full copy (us each)" << fullTime * 1e6 / numForks << "\n";
+    report << left << setw(28) << "Forks, unchanged (KB)" << setprecision(1) << forkBytes / 1024.0 << "\n";
+    report << left << setw(28) << "Forks, after changes (KB)" << changedBytes / 1024.0 << "\n";
+    report << left << setw(28) << "Full copies (KB, est.)" << fullBytes / 1024.0 << "\n";
+    forks.clear();
+    report << left << setw(28) << "Forks isolated" << (isolated ? "yes" : "NO") << "\n";
+    report << left << setw(28) << "Original unchanged" << (printed(st) == before && (!indexes || st.prefixLookup("fork").empty()) ? "yes" : "NO") << "\n\n";
+}
+
+void benchmarkFork(int numBuckets, int numSymbols, int numThreads, ostream& report) {
+    for (bool indexes : {false, true}) {
+        ScopeConfig config;
+        config.prefixIndex = indexes;
+        config.suggestIndex = indexes;
+        benchmarkForks(numBuckets, numSymbols, numThreads, config, report);
+    }
+}
+
+// The same declarations stored as type text and as attributes: heap in use,
+// and the cost of asking each symbol (already looked up) for a function's
+// return type and parameter count, by re-parsing the text or by reading the
+// attributes.
+// Both tables must print the same.
+void benchmarkAttributes(int numBuckets, int numSymbols, ostream& report) {
+    const char* types[] = {"INT", "FLOAT", "BOOL"};
+    vector<string> texts;
+    for (int i = 0; i < numSymbols; i++) {
+        if (i % 3 == 0) texts.push_back(types[i % 2]);
+        else if (i % 3 == 1) texts.push_back(string("FUNCTION,") + types[i % 3] + "<==(INT,FLOAT,INT)");
+        else texts.push_back("STRUCT,{(INT,n_doors),(BOOL,is_electric)}");
+    }
+
+    report << "Attributes, " << numSymbols << " symbols, " << numBuckets << " buckets\n";
+    report << "----------------------------------------\n";
+    vector<string> prints;
+    for (bool typed : {false, true}) {
+        size_t heap = heapInUse();
+        SymbolTable st(numBuckets);
+        for (int i = 0; i < numSymbols; i++) {
+            SymbolAttributes attributes;
+            if (typed && SymbolAttributes::parse(texts[i], &attributes)) st.insert(symbolName(i), attributes);
+            else st.insert(symbolName(i), texts[i]);
+        }
+        size_t bytes = heapInUse() - heap;
+
+        vector<SymbolInfo*> symbols;
+        for (int i = 0; i < numSymbols; i++) symbols.push_back(st.getCurrentScope() -> lookup(symbolName(i)));
+        auto start = chrono::steady_clock::now();
+        long long answer = 0;
+        for (int round = 0; round < 10; round++) {
+            for (SymbolInfo* symbol : symbols) {
+                const SymbolAttributes& attributes = symbol -> getAttributes();
+                if (attributes.isTyped()) {
+                    if (attributes.kind == SymbolKind::Function)
+                        answer += (int) attributes.dataType + attributes.paramList().size();
+                    continue;
+                }
+                const string& type = symbol -> getInsertedType();
+                if (type.compare(0, 9, "FUNCTION,") != 0) continue;
+                size_t arrow = type.find("<==(");
+                DataType returns = DataType::None;
+                parseDataType(string_view(type).substr(9, arrow - 9), &returns);
+                answer += (int) returns + count(type.begin() + arrow, type.end(), ',') + 1;
+            }
+        }
+        double seconds = elapsedSeconds(start);
+        report << left << setw(24) << (typed ? "Attributes (KB)" : "Text (KB)") << fixed << setprecision(1)
+               << bytes / 1024.0 << "\n";
+        report << left << setw(24) << (typed ? "Attributes queries/sec" : "Text queries/sec") << setprecision(0)
+               << 10.0 * numSymbols / seconds << "   (" << answer << ")\n";
+        prints.push_back(printed(st));
+    }
+    report << left << setw(24) << "Same print" << (prints[0] == prints[1] ? "yes" : "NO") << "\n\n";
+}
+
+// Tables kept in a pool and reused across jobs, against a new table per
+// job. A job fills the global scope and a few nested ones; a cleared table
+// must give the same print and log as a new one and, once it has run a job
+// that large, take nothing more from the heap. Also times moving tables
+// around a vector and checks that a clone is equal to, and independent of,
+// its original.
+void runJob(SymbolTable& st, int job, int numSymbols) {
+    for (int i = 0; i < numSymbols; i++) st.insert(symbolName(i), "GLOBAL");
+    for (int depth = 0; depth < 4; depth++) {
+        st.enterScope();
+        for (int i = 0; i < numSymbols / 8; i++) st.insert(symbolName((i + job) * 3 + depth), "LOCAL");
+        for (int i = 0; i < numSymbols / 8; i++) st.lookup(symbolName(i * 5));
+    }
+    for (int depth = 0; depth < 2; depth++) st.exitScope();
+}
+
+void benchmarkPool(int numBuckets, int numSymbols, ostream& report) {
+    const int numJobs = 50, poolSize = 4;
+    report << "Pool, " << numSymbols << " symbols, " << numBuckets << " buckets, " << numJobs << " jobs\n";
+    report << "----------------------------------------\n";
+
+    auto start = chrono::steady_clock::now();
+    for (int job = 0; job < numJobs; job++) {
+        SymbolTable st(numBuckets);
+        runJob(st, job, numSymbols);
+    }
+    double freshSeconds = elapsedSeconds(start);
+
+    vector<SymbolTable> pool;
+    for (int i = 0; i < poolSize; i++) pool.push_back(SymbolTable(numBuckets)); // moved in, and moved on growth
+    bool same = true;
+    size_t growth = 0;
+    double pooledSeconds = 0;
+    for (int job = 0; job < numJobs; job++) {
+        SymbolTable& st = pool[job % poolSize];
+        start = chrono::steady_clock::now();
+        st.clear();
+        pooledSeconds += elapsedSeconds(start);
+        size_t heap = heapInUse(); // walks malloc's bins, so kept out of the timing
+        start = chrono::steady_clock::now();
+        runJob(st, job, numSymbols);
+        pooledSeconds += elapsedSeconds(start);
+        if (job >= poolSize) growth += heapInUse() - heap;
+    }
+
+    for (int job : {0, 7}) {
+        ostringstream freshLog, pooledLog;
+        SymbolTable fresh(numBuckets);
+        fresh.setOutputStream(&freshLog);
+        runJob(fresh, job, numSymbols / 10);
+        fresh.setOutputStream(nullptr);
+        SymbolTable& pooled = pool[0];
+        pooled.clear();
+        pooled.setOutputStream(&pooledLog);
+        runJob(pooled, job, numSymbols / 10);
+        pooled.setOutputStream(nullptr);
+        same = same && freshLog.str() == pooledLog.str() && printed(fresh) == printed(pooled);
+    }
+
+    start = chrono::steady_clock::now();
+    const int numMoves = 100000;
+    for (int i = 0; i < numMoves; i++) {
+        SymbolTable taken(move(pool[i % poolSize]));
+        pool[i % poolSize] = move(taken);
+    }
+    double moveSeconds = elapsedSeconds(start);
+
+    SymbolTable& original = pool[1];
+    string before = printed(original);
+    start = chrono::steady_clock::now();
+    SymbolTable copy = original.clone();
+    double cloneSeconds = elapsedSeconds(start);
+    bool cloned = printed(copy) == before;
+    copy.insert("only_in_clone", "INT");
+    copy.remove(symbolName(0));
+    cloned = cloned && printed(original) == before && original.lookup("only_in_clone") == nullptr;
+
+    report << left << setw(28) << "New table per job (ms)" << fixed << setprecision(2) << freshSeconds * 1e3 << "\n";
+    report << left << setw(28) << "Pooled tables (ms)" << pooledSeconds * 1e3 << "\n";
+    report << left << setw(28) << "Heap growth per reuse (B)" << setprecision(0) << growth / (numJobs - poolSize) << "\n";
+    report << left << setw(28) << "Move (ns)" << setprecision(1) << moveSeconds * 1e9 / (2 * numMoves) << "\n";
+    report << left << setw(28) << "Clone (ms)" << setprecision(2) << cloneSeconds * 1e3 << "\n";
+    report << left << setw(28) << "Same as a new table" << (same ? "yes" : "NO") << "\n";
+    report << left << setw(28) << "Clone equal, independent" << (cloned ? "yes" : "NO") << "\n\n";
+}
+
+// Large scopes entered, filled and exited, with the exited ones freed on
+// the spot, by a background thread, or in amortized steps. Reports the
+// slowest exitScope and the slowest insert, since the deferred modes move
+// the cost from the one to the other or off the thread entirely, and the
+// most memory left waiting. Lifetime stats, allocations aside, must not
+// depend on the mode.
+void benchmarkReclaim(int numBuckets, int numSymbols, ostream& report) {
+    const int rounds = 20;
+    report << "Reclaim, " << numSymbols << " symbols per scope, " << numBuckets << " buckets, " << rounds
+           << " scopes\n";
+    report << "----------------------------------------\n";
+    vector<string> stats;
+    for (ReclaimMode mode : {ReclaimMode::Inline, ReclaimMode::Background, ReclaimMode::Amortized}) {
+        ScopeConfig config;
+        config.prefixIndex = true;
+        config.reclaim = mode;
+        config.reclaimLimit = 16 << 20;
+        SymbolTable st(numBuckets, config);
+        double slowestExit = 0, slowestInsert = 0;
+        size_t mostPending = 0;
+        auto start = chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++) {
+            st.enterScope();
+            for (int i = 0; i < numSymbols; i++) {
+                auto before = chrono::steady_clock::now();
+                st.insert(symbolName(i), "LOCAL");
+                slowestInsert = max(slowestInsert, elapsedSeconds(before));
+            }
+            st.lookup(symbolName(round));
+            auto before = chrono::steady_clock::now();
+            st.exitScope();
+            slowestExit = max(slowestExit, elapsedSeconds(before));
+            mostPending = max(mostPending, st.getPendingReclaim());
+        }
+        double seconds = elapsedSeconds(start);
+        // reused emptied scopes make fewer allocations; everything else must match
+        ScopeStats lifetime = st.lifetimeStats();
+        unsigned long long allocations = lifetime.allocations;
+        lifetime.allocations = lifetime.allocatedBytes = 0;
+        ostringstream json;
+        lifetime.printJson(json);
+        stats.push_back(json.str());
+
+        const char* name = mode == ReclaimMode::Inline ? "Inline" : mode == ReclaimMode::Background ? "Background" : "Amortized";
+        report << name << "\n";
+        report << left << setw(28) << "  Total (ms)" << fixed << setprecision(1) << seconds * 1e3 << "\n";
+        report << left << setw(28) << "  Slowest exitScope (us)" << slowestExit * 1e6 << "\n";
+        report << left << setw(28) << "  Slowest insert (us)" << slowestInsert * 1e6 << "\n";
+        report << left << setw(28) << "  Most pending (KB)" << mostPending / 1024.0 << "\n";
+        report << left << setw(28) << "  Allocations" << allocations << "\n";
+    }
+    report << left << setw(28) << "Same lifetime stats" << (stats[0] == stats[1] && stats[0] == stats[2] ? "yes" : "NO")
+           << "\n\n";
+}
+
+// A compiler-like workload: runs of four nested block scopes under the
+// globals, each declaring a few locals and looking up names, three in four
+// of them locals of an enclosing scope and the rest globals (one in five of
+// those is nowhere), with
+// scopes starting in small mode and with a bucket array from the start.
+// Every few hundred scopes one grows past small mode. The log and the
+// printed tables must come out the same either way.
+string runBlocks(const ScopeConfig& config, int numBuckets, int numScopes, double& seconds, double& lookupSeconds,
+                 int& promoted) {
+    mt19937 rng(50);
+    SymbolTable st(numBuckets, config);
+    vector<string> globals;
+    for (int i = 0; i < 80; i++) globals.push_back(symbolName(i));
+    vector<vector<string>> locals(4); // by depth
+    for (int depth = 0; depth < 4; depth++) {
+        for (int i = 0; i < 40; i++) locals[depth].push_back("t" + to_string(i) + "_" + to_string(depth + 1));
+    }
+    for (int i = 0; i < 64; i++) st.insert(globals[i], "GLOBAL");
+    promoted = 0;
+    lookupSeconds = 0;
+    ostringstream out;
+    if (config.os != nullptr) st.setOutputStream(&out);
+    vector<const string*> names(16);
+    vector<int> declared(5); // by depth
+    auto start = chrono::steady_clock::now();
+    for (int scope = 0; scope < numScopes; scope++) {
+        st.enterScope();
+        size_t depth = st.getDepth();
+        int count = scope % 300 == 0 ? 40 : 1 + rng() % 7;
+        for (int i = 0; i < count; i++) st.insert(locals[depth - 1][i], "LOCAL");
+        declared[depth] = count;
+        for (int i = 0; i < 16; i++) {
+            size_t from = 1 + rng() % depth;
+            names[i] = i % 4 ? &locals[from - 1][rng() % declared[from]] : &globals[rng() % 80];
+        }
+        auto lookups = chrono::steady_clock::now();
+        for (const string* name : names) st.lookup(*name);
+        lookupSeconds += elapsedSeconds(lookups);
+        if (count > 2) st.remove(locals[depth - 1][1]);
+        if (scope % 1000 == 0 && config.os != nullptr) st.printAllScope();
+        promoted += !st.getCurrentScope() -> isSmall();
+        if (depth == 4) {
+            while (st.getDepth() > 0) st.exitScope();
+        }
+    }
+    seconds = elapsedSeconds(start);
+    st.setOutputStream(nullptr);
+    return out.str();
+}
+
+void benchmarkSmall(int numBuckets, int numSymbols, ostream& report) {
+    // the bucket counts of the sample inputs, then the one asked for
+    vector<int> bucketCounts = {7, 13};
+    if (numBuckets != 7 && numBuckets != 13) bucketCounts.push_back(numBuckets);
+    for (int buckets : bucketCounts) {
+        report << "Small scopes, " << numSymbols << " block scopes, " << buckets << " buckets\n";
+        report << "----------------------------------------\n";
+        vector<string> logs;
+        for (bool small : {false, true}) {
+            ScopeConfig config;
+            config.smallScopes = small;
+            double seconds = 0, lookupSeconds = 0;
+            int promoted = 0;
+            runBlocks(config, buckets, numSymbols, seconds, lookupSeconds, promoted);
+            ostringstream sink;
+            config.os = &sink;
+            double loggedSeconds = 0, loggedLookups = 0;
+            logs.push_back(runBlocks(config, buckets, numSymbols, loggedSeconds, loggedLookups, promoted));
+            report << (small ? "Small mode" : "Bucket array") << "\n";
+            report << left << setw(28) << "  Total (ms)" << fixed << setprecision(1) << seconds * 1e3 << "\n";
+            report << left << setw(28) << "  Per scope (ns)" << seconds * 1e9 / numSymbols << "\n";
+            report << left << setw(28) << "  Per lookup (ns)" << lookupSeconds * 1e9 / (16.0 * numSymbols) << "\n";
+            report << left << setw(28) << "  Scopes with an array" << promoted << "\n";
+        }
+        report << left << setw(28) << "Same log and prints" << (logs[0] == logs[1] ? "yes" : "NO") << "\n\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " <benchmark> <num_buckets> <num_symbols> [threads]\n";
+        cerr << "Benchmarks: concurrent, sharded, batch, snapshot, shared, logging, zipf, treeify, prefix, suggest, depth, freeze, rollback, fork, attributes, pool, reclaim, small\n";
+        cerr << "Example: " << argv[0] << " concurrent 97 10000 4\n";
+        return 1;
+    }
+
+    string name = argv[1];
+    int numBuckets = stoi(argv[2]);
+    int numSymbols = stoi(argv[3]);
+    int threads = argc >= 5 ? stoi(argv[4]) : max(1u, thread::hardware_concurrency());
+
+    if (name == "concurrent") {
+        benchmarkConcurrent(numBuckets, numSymbols, threads, cout);
+    } else if (name == "sharded") {
+        benchmarkSharded(numBuckets, numSymbols, threads, cout);
+    } else if (name == "batch") {
+        benchmarkBatch(numBuckets, numSymbols, cout);
+    } else if (name == "snapshot") {
+        benchmarkSnapshot(numBuckets, numSymbols, cout);
+    } else if (name == "shared") {
+        benchmarkShared(numBuckets, numSymbols, threads, cout);
+    } else if (name == "logging") {
+        benchmarkLogging(numBuckets, numSymbols, cout);
+    } else if (name == "zipf") {
+        benchmarkZipf(numBuckets, numSymbols, cout);
+    } else if (name == "treeify") {
+        benchmarkTreeify(numBuckets, numSymbols, cout);
+    } else if (name == "prefix") {
+        benchmarkPrefix(numBuckets, numSymbols, cout);
+    } else if (name == "suggest") {
+        benchmarkSuggest(numBuckets, numSymbols, cout);
+    } else if (name == "depth") {
+        benchmarkDepth(numBuckets, numSymbols, cout);
+    } else if (name == "freeze") {
+        benchmarkFreeze(numBuckets, numSymbols, cout);
+    } else if (name == "rollback") {
+        benchmarkRollback(numBuckets, numSymbols, cout);
+    } else if (name == "fork") {
+        benchmarkFork(numBuckets, numSymbols, threads, cout);
+    } else if (name == "attributes") {
+        benchmarkAttributes(numBuckets, numSymbols, cout);
+    } else if (name == "pool") {
+        benchmarkPool(numBuckets, numSymbols, cout);
+    } else if (name == "reclaim") {
+        benchmarkReclaim(numBuckets, numSymbols, cout);
+    } else if (name == "small") {
+        benchmarkSmall(numBuckets, numSymbols, cout);
+    } else {
+        cerr << "Unknown benchmark: " << name << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -73,6 +73,48 @@ string formatType(const string& baseType, istringstream& ss) {
         return baseType + (params.empty()? "": ","+ params);
 }
 
+// The attributes of an I command, built from its tokens: the base type and
+// what follows it, read as formatType reads them. False when the
+// declaration has no attribute form (a type name the table does not know,
+// say), and it is kept as formatType's text instead.
+bool declarationAttributes(const string& baseType, const string& params, SymbolAttributes* attributes) {
+    istringstream iss(params);
+    if (baseType == "FUNCTION") {
+        string token;
+        DataType returns = DataType::None;
+        if (!(iss >> token) || !parseDataType(token, &returns)) {
+            return false;
+        }
+        ParamList args;
+        while (args.size() < MAX_ARGS - 1 && iss >> token) {
+            DataType type = DataType::None;
+            if (!parseDataType(token, &type)) {
+                return false;
+            }
+            args.push_back({type, ""});
+        }
+        *attributes = SymbolAttributes::function(returns, args);
+        return true;
+    }
+
+    else if (baseType == "STRUCT" || baseType == "UNION") {
+        ParamList fields;
+        string type, name;
+        while (fields.size() < MAX_FIELDS - 1 && iss >> type >> name) {
+            DataType field = DataType::None;
+            if (!parseDataType(type, &field) || name.find(')') != string::npos) {
+                return false;
+            }
+            fields.push_back({field, name});
+        }
+        *attributes = SymbolAttributes::record(baseType == "STRUCT" ? SymbolKind::Struct : SymbolKind::Union, fields);
+        return true;
+    }
+
+    else
+        return params.empty() && SymbolAttributes::parseVariable(baseType, attributes);
+}
+
 void generateTestInputFile(const string& filename, int numBuckets, int numSymbols) {
     ofstream outFile(filename);
     if (!outFile) {
@@ -129,27 +171,31 @@ void generateTestInputFile(const string& filename, int numBuckets, int numSymbol
     outFile.close();
 }
 
-double testHashFunction(unsigned long (*hashFunc)(const std::string&, int), const string& inputFile) {
-    // Set up symbol table with this hash function
-    ScopeTable::setHashFunction(hashFunc);
-    
-    // Disable console output during testing
-    ofstream nullStream;
-    SymbolTable::setOutputStream(&nullStream);
-    ScopeTable::setOutputStream(&nullStream);
+// Collision ratio over the scopes still open at the end of the run, and
+// over every scope the run ever created.
+struct RatioResult {
+    double live;
+    double lifetime;
+};
+
+RatioResult testHashFunction(unsigned long (*hashFunc)(const std::string&, int), const string& inputFile) {
+    // Set up symbol table with this hash function; NullLogger compiles
+    // every log call away, so only the table itself is measured
+    ScopeConfig config;
+    config.hashfunc = hashFunc;
 
     // Read input file
     ifstream infile(inputFile);
     if (!infile) {
         cerr << "Error opening input file: " << inputFile << endl;
-        return -1.0;
+        return {-1.0, -1.0};
     }
 
     // First line contains number of buckets
     string line;
     getline(infile, line);
     int numBuckets = stoi(trim(line));
-    SymbolTable st(numBuckets);
+    BasicSymbolTable<NullLogger> st(numBuckets, config);
 
     // Process commands
     while (getline(infile, line)) {
@@ -167,9 +213,14 @@ double testHashFunction(unsigned long (*hashFunc)(const std::string&, int), cons
             getline(ss, remaining);
             remaining = trim(remaining);
             
-            istringstream paramStream(remaining);
-            string formattedType = formatType(baseType, paramStream);
-            st.insert(name, formattedType);
+            SymbolAttributes attributes;
+            if (declarationAttributes(baseType, remaining, &attributes)) {
+                st.insert(name, attributes);
+            }
+            else {
+                istringstream paramStream(remaining);
+                st.insert(name, formatType(baseType, paramStream));
+            }
         }
         else if (cmd == "L") {
             string name;
@@ -193,7 +244,13 @@ double testHashFunction(unsigned long (*hashFunc)(const std::string&, int), cons
     }
 
     infile.close();
-    return st.getRatio();
+    return {st.getRatio(), st.getLifetimeRatio()};
+}
+
+void writeResultRow(ostream& reportFile, const string& name, const RatioResult& result) {
+    reportFile << left << setw(15) << name
+               << setw(20) << fixed << setprecision(4) << result.live
+               << setw(20) << result.lifetime << "\n";
 }
 
 void runComparisonTest(const string& inputFile, const string& outputFilename) {
@@ -219,26 +276,22 @@ void runComparisonTest(const string& inputFile, const string& outputFilename) {
 
     // Test each hash function
     reportFile << "Performance Results:\n";
-    reportFile << "----------------------------------------\n";
+    reportFile << "-------------------------------------------------------\n";
     reportFile << left << setw(15) << "Hash Function" 
-               << setw(20) << "Collision Ratio" << "\n";
-    reportFile << "----------------------------------------\n";
-
-    reportFile << left << setw(15) << "SDBM" 
-               << setw(20) << fixed << setprecision(4) 
-               << testHashFunction(SDBMHash, inputFile) << "\n";
-    
-    reportFile << left << setw(15) << "FNV-1a" 
-               << setw(20) << fixed << setprecision(4) 
-               << testHashFunction(fnv1a_hash, inputFile) << "\n";
-    
-    reportFile << left << setw(15) << "Jenkins" 
-               << setw(20) << fixed << setprecision(4) 
-               << testHashFunction(jenkins_hash, inputFile) << "\n";
-    
-    reportFile << left << setw(15) << "Murmur" 
-               << setw(20) << fixed << setprecision(4) 
-               << testHashFunction(murmur_hash, inputFile) << "\n";
+               << setw(20) << "Live Ratio"
+               << setw(20) << "Lifetime Ratio" << "\n";
+    reportFile << "-------------------------------------------------------\n";
+
+    // Every run owns its own table and config, so all four go at once
+    future<RatioResult> sdbm = async(launch::async, testHashFunction, SDBMHash, inputFile);
+    future<RatioResult> fnv = async(launch::async, testHashFunction, fnv1a_hash, inputFile);
+    future<RatioResult> jenkins = async(launch::async, testHashFunction, jenkins_hash, inputFile);
+    future<RatioResult> murmur = async(launch::async, testHashFunction, murmur_hash, inputFile);
+
+    writeResultRow(reportFile, "SDBM", sdbm.get());
+    writeResultRow(reportFile, "FNV-1a", fnv.get());
+    writeResultRow(reportFile, "Jenkins", jenkins.get());
+    writeResultRow(reportFile, "Murmur", murmur.get());
 
     reportFile.close();
 }
@@ -71,6 +71,48 @@ string formatType(const string& baseType, istringstream& ss){
         return baseType + (params.empty()? "": ","+ params);
 }
 
+// The attributes of an I command, built from its tokens: the base type and
+// what follows it, read as formatType reads them. False when the
+// declaration has no attribute form (a type name the table does not know,
+// say), and it is kept as formatType's text instead.
+bool declarationAttributes(const string& baseType, const string& params, SymbolAttributes* attributes){
+    istringstream iss(params);
+    if (baseType == "FUNCTION"){
+        string token;
+        DataType returns = DataType::None;
+        if (!(iss >> token) || !parseDataType(token, &returns)){
+            return false;
+        }
+        ParamList args;
+        while (args.size() < MAX_ARGS - 1 && iss >> token){
+            DataType type = DataType::None;
+            if (!parseDataType(token, &type)){
+                return false;
+            }
+            args.push_back({type, ""});
+        }
+        *attributes = SymbolAttributes::function(returns, args);
+        return true;
+    }
+
+    else if (baseType == "STRUCT" || baseType == "UNION"){
+        ParamList fields;
+        string type, name;
+        while (fields.size() < MAX_FIELDS - 1 && iss >> type >> name){
+            DataType field = DataType::None;
+            if (!parseDataType(type, &field) || name.find(')') != string::npos){
+                return false;
+            }
+            fields.push_back({field, name});
+        }
+        *attributes = SymbolAttributes::record(baseType == "STRUCT" ? SymbolKind::Struct : SymbolKind::Union, fields);
+        return true;
+    }
+
+    else
+        return params.empty() && SymbolAttributes::parseVariable(baseType, attributes);
+}
+
 void processLine(const string& line, SymbolTable& st, ostream& out, int cmdCount){
     istringstream ss(line);
     string cmd;
@@ -94,10 +136,17 @@ void processLine(const string& line, SymbolTable& st, ostream& out, int cmdCount
                 throw runtime_error("Number of parameters mismatch for the command I");
             }
 
-            istringstream paramStream(remaining);
-            string formattedType = formatType(baseType, paramStream);
+            SymbolAttributes attributes;
+            bool inserted;
+            if (declarationAttributes(baseType, remaining, &attributes)){
+                inserted = st.insert(name, attributes);
+            }
+            else {
+                istringstream paramStream(remaining);
+                inserted = st.insert(name, formatType(baseType, paramStream));
+            }
             
-            if (!st.insert(name, formattedType)) {
+            if (!inserted) {
                 buffer << "'" << name << "' already exists in the current ScopeTable\n";
             }
         }
@@ -143,6 +192,14 @@ void processLine(const string& line, SymbolTable& st, ostream& out, int cmdCount
             else st.printAllScope();
         }
         
+        else if (cmd == "M"){
+            string extra;
+            if (ss >> extra){
+                throw runtime_error("Number of parameters mismatch for the command M");
+            }
+            st.memoryStats().print(buffer);
+        }
+
         else if (cmd == "S") st.enterScope();
         else if (cmd == "E") st.exitScope();
         else if (cmd == "Q") {
@@ -167,7 +224,7 @@ int main(int argc, char const *argv[]){
     cout<<"Running fine\n";
 
     if (argc < 3){
-        cerr << "Usage: " << argv[0] << " <input_file> <output_file> [hash_function]\n";
+        cerr << "Usage: " << argv[0] << " <input_file> <output_file> [hash_function] [bucket_policy]\n";
         return 1;
     }
 
@@ -179,14 +236,23 @@ int main(int argc, char const *argv[]){
         }
     }
 
+    ScopeConfig config;
     if (hashfunc == "SDBM"){
-        ScopeTable::setHashFunction(SDBMHash);
+        config.hashfunc = SDBMHash;
     } else if (hashfunc == "JENKINS"){
-        ScopeTable::setHashFunction(jenkins_hash);
+        config.hashfunc = jenkins_hash;
     } else if (hashfunc == "MURMUR"){
-        ScopeTable::setHashFunction (murmur_hash);
+        config.hashfunc = murmur_hash;
     } else if (hashfunc == "FNV1A"){
-        ScopeTable::setHashFunction(fnv1a_hash);
+        config.hashfunc = fnv1a_hash;
+    }
+
+    // hot names drift to the front of their chains; positions in the log follow
+    string policy = argc >= 5 ? trim(argv[4]) : "";
+    if (policy == "MTF"){
+        config.bucketPolicy = BucketPolicy::MoveToFront;
+    } else if (policy == "TRANSPOSE"){
+        config.bucketPolicy = BucketPolicy::Transpose;
     }
     
     //file handling
@@ -198,14 +264,13 @@ int main(int argc, char const *argv[]){
         return 1;
     }
 
-    SymbolTable::setOutputStream(&outfile);
-    ScopeTable::setOutputStream(&outfile);
+    config.os = &outfile;
 
     string line;
     getline(infile, line);
     int numBuckets = stoi(trim(line));
 
-    SymbolTable st(numBuckets);
+    SymbolTable st(numBuckets, config);
     int cmdCount = 0;
 
     // processing commands
@@ -0,0 +1,63 @@
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include <iostream>
+#include <string>
+
+// Bytes held by a ScopeTable, or summed over a SymbolTable's scope chain.
+// String characters that fit in std::string's own buffer are already part of
+// nodeBytes; only the ones spilled to the heap add to heapStringBytes.
+struct MemoryStats{
+    size_t tableBytes = 0;        // the ScopeTable objects themselves
+    size_t bucketBytes = 0;       // bucket pointer arrays
+    size_t nodeBytes = 0;         // SymbolInfo nodes
+    size_t inlineStringBytes = 0; // characters stored inside the nodes
+    size_t heapStringBytes = 0;   // heap buffers of longer strings
+    size_t heapStrings = 0;
+    size_t symbols = 0;
+    size_t buckets = 0;
+    int scopes = 0;
+
+    void addString(const std::string& str){
+        const char* data = str.data();
+        const char* object = reinterpret_cast<const char*>(&str);
+        if (data >= object && data < object + sizeof(std::string)){
+            inlineStringBytes += str.size();
+        } else {
+            heapStringBytes += str.capacity() + 1;
+            heapStrings++;
+        }
+    }
+
+    size_t totalBytes() const {
+        return tableBytes + bucketBytes + nodeBytes + heapStringBytes;
+    }
+
+    double loadFactor() const {
+        return buckets == 0 ? 0.0 : symbols / (buckets * 1.0);
+    }
+
+    MemoryStats& operator+=(const MemoryStats& other){
+        tableBytes += other.tableBytes;
+        bucketBytes += other.bucketBytes;
+        nodeBytes += other.nodeBytes;
+        inlineStringBytes += other.inlineStringBytes;
+        heapStringBytes += other.heapStringBytes;
+        heapStrings += other.heapStrings;
+        symbols += other.symbols;
+        buckets += other.buckets;
+        scopes += other.scopes;
+        return *this;
+    }
+
+    void print(std::ostream& os, const std::string& indent = "") const {
+        os << indent << "Memory: " << totalBytes() << " bytes in " << scopes << " scope(s)\n";
+        os << indent << "\tscope tables: " << tableBytes << "\n";
+        os << indent << "\tbucket arrays: " << bucketBytes << "\n";
+        os << indent << "\tsymbol nodes: " << nodeBytes << " (" << inlineStringBytes << " inline string bytes)\n";
+        os << indent << "\theap strings: " << heapStringBytes << " in " << heapStrings << " buffer(s)\n";
+        os << indent << "\tload factor: " << symbols << "/" << buckets << " = " << loadFactor() << "\n";
+    }
+};
+
+#endif
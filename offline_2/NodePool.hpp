@@ -0,0 +1,59 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include "SymbolInfo.hpp"
+
+// Room for Capacity symbol nodes inside the owning object, so a table
+// sized for its workload never asks the heap for a node. Freed nodes are
+// reused first; once all Capacity are live, further nodes come from the
+// heap and overflowed() counts them.
+template <size_t Capacity>
+class NodePool {
+    alignas(SymbolInfo) unsigned char storage[Capacity * sizeof(SymbolInfo)];
+    void* freeList; // dead slots, linked through their own bytes
+    size_t used;    // slots handed out at least once
+    size_t overflow;
+
+    bool owns(SymbolInfo* symbol) const {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(symbol);
+        return p >= storage && p < storage + sizeof(storage);
+    }
+
+public:
+    NodePool() : freeList(nullptr), used(0), overflow(0) {}
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    SymbolInfo* create(const std::string& name, const std::string& type) {
+        void* slot;
+        if (freeList != nullptr) {
+            slot = freeList;
+            freeList = *static_cast<void**>(slot);
+        } else if (used < Capacity) {
+            slot = storage + used++ * sizeof(SymbolInfo);
+        } else {
+            overflow++;
+            return new SymbolInfo(name, type);
+        }
+        return new (slot) SymbolInfo(name, type);
+    }
+
+    void destroy(SymbolInfo* symbol) {
+        if (!owns(symbol)) {
+            delete symbol;
+            return;
+        }
+        symbol->~SymbolInfo();
+        *reinterpret_cast<void**>(symbol) = freeList;
+        freeList = symbol;
+    }
+
+    size_t capacity() const { return Capacity; }
+    size_t overflowed() const { return overflow; }
+};
+
+#endif
@@ -1,23 +1,78 @@
 #ifndef SCOPETABLE_H
 #define SCOPETABLE_H
 
+#include <array>
 #include <iostream>
+#include <type_traits>
+#include <vector>
 #include "SymbolInfo.hpp"
 #include "Hashfunctions.hpp"
+#include "MemoryStats.hpp"
+#include "NodePool.hpp"
 
-class ScopeTable {
-    SymbolInfo** buckets;
+// Hash function and log stream, shared by every kind of ScopeTable.
+class ScopeTableBase {
+protected:
+    static unsigned int (*hashfunc)(const char*);
+    static std::ostream* os;
+
+public:
+    static void setHashFunction(unsigned int (*func)(const char*)) {
+        hashfunc = func;
+    }
+
+    static void setOutputStream(std::ostream* outputStream) {
+        os = outputStream;
+    }
+};
+
+// N > 0 fixes the bucket count at compile time: the buckets and their
+// occupancy bits live inside the object and the bucket index is taken
+// modulo a constant. Capacity > 0 takes nodes from a NodePool, normally
+// the one its SymbolTable shares between scopes. ScopeTable is the
+// runtime-sized, heap-backed table.
+template <unsigned N = 0, size_t Capacity = 0>
+class BasicScopeTable : public ScopeTableBase {
+    typedef std::conditional_t<(N > 0), std::array<SymbolInfo*, N>, SymbolInfo**> BucketArray;
+    typedef std::conditional_t<(N > 0), std::array<unsigned long long, (N + 63) / 64>,
+                               std::vector<unsigned long long>> OccupiedArray;
+
+    BucketArray buckets;
     int num_buckets;
-    ScopeTable* parent_scope;
+    OccupiedArray occupied; // bit i set <=> bucket i is non-empty
+    NodePool<Capacity>* pool;
+    BasicScopeTable* parent_scope;
     std::string id;
     int childCount;
     double collisions;
-    static unsigned int (*hashfunc)(const char*);
-    static std::ostream* os;
+
+    unsigned int bucketOf(const std::string& name) {
+        if constexpr (N > 0) return hashfunc(name.c_str()) % N;
+        else return hashfunc(name.c_str()) % num_buckets;
+    }
+
+    SymbolInfo* newNode(const std::string& name, const std::string& type) {
+        if constexpr (Capacity > 0) return pool->create(name, type);
+        else return new SymbolInfo(name, type);
+    }
+
+    void freeNode(SymbolInfo* symbol) {
+        if constexpr (Capacity > 0) pool->destroy(symbol);
+        else delete symbol;
+    }
+
+    void markOccupied(unsigned int index) {
+        occupied[index / 64] |= 1ULL << (index % 64);
+    }
+
+    void markEmpty(unsigned int index) {
+        occupied[index / 64] &= ~(1ULL << (index % 64));
+    }
 
 public:
-    ScopeTable(int n, ScopeTable* parent) : 
-        num_buckets(n), parent_scope(parent), childCount(0), collisions(0) {
+    // n is ignored when N is fixed; pool is required when Capacity is.
+    BasicScopeTable(int n, BasicScopeTable* parent, NodePool<Capacity>* nodes = nullptr) :
+        num_buckets(N > 0 ? N : n), pool(nodes), parent_scope(parent), childCount(0), collisions(0) {
         if (parent == nullptr) {
             id = "1";
         } else {
@@ -25,40 +80,38 @@ public:
             id = parent->id + "." + std::to_string(childNumber);
             parent->childCount = childNumber;
         }
-        buckets = new SymbolInfo*[num_buckets]();
+        if constexpr (N > 0) {
+            buckets.fill(nullptr);
+            occupied.fill(0);
+        } else {
+            buckets = new SymbolInfo*[num_buckets]();
+            occupied.assign((num_buckets + 63) / 64, 0);
+        }
         if (os != nullptr) {
             os->flush();
         }
     }
 
-    ~ScopeTable() {
+    ~BasicScopeTable() {
         for (size_t i = 0; i < num_buckets; i++) {
             SymbolInfo* currentBucket = buckets[i];
             while (currentBucket != nullptr) {
                 SymbolInfo* next = currentBucket->getNext();
-                delete currentBucket;
+                freeNode(currentBucket);
                 currentBucket = next;
             }
         }
-        delete[] buckets;
+        if constexpr (N == 0) delete[] buckets;
         if (os != nullptr) {
             os->flush();
         }
     }
 
     std::string getId() { return id; }
-    ScopeTable* getParent() { return parent_scope; }
-
-    static void setHashFunction(unsigned int (*func)(const char*)) {
-        hashfunc = func;
-    }
-
-    static void setOutputStream(std::ostream* outputStream) {
-        os = outputStream;
-    }
+    BasicScopeTable* getParent() { return parent_scope; }
 
     bool insert(const std::string& name, const std::string& type) {
-        unsigned int index = hashfunc(name.c_str()) % num_buckets;
+        unsigned int index = bucketOf(name);
         SymbolInfo* current = buckets[index];
         SymbolInfo* prev = nullptr;
         int position = 0;
@@ -81,9 +134,11 @@ public:
             position++;
         }
 
-        SymbolInfo* newSymbol = new SymbolInfo(name, type);
-        if (prev == nullptr)
+        SymbolInfo* newSymbol = newNode(name, type);
+        if (prev == nullptr) {
             buckets[index] = newSymbol;
+            markOccupied(index);
+        }
         else
             prev->setNext(newSymbol);
 
@@ -91,7 +146,7 @@ public:
     }
 
     SymbolInfo* lookup(const std::string& name) {
-        unsigned int index = hashfunc(name.c_str()) % num_buckets;
+        unsigned int index = bucketOf(name);
         SymbolInfo* current = buckets[index];
         int position = 1;
 
@@ -106,7 +161,7 @@ public:
     }
 
     bool remove(const std::string& name) {
-        unsigned int index = hashfunc(name.c_str()) % num_buckets;
+        unsigned int index = bucketOf(name);
         SymbolInfo* current = buckets[index];
         SymbolInfo* prev = nullptr;
         int position = 1;
@@ -117,7 +172,8 @@ public:
                     buckets[index] = current->getNext();
                 else
                     prev->setNext(current->getNext());
-                delete current;
+                if (buckets[index] == nullptr) markEmpty(index);
+                freeNode(current);
                 return true;
             }
             prev = current;
@@ -127,29 +183,66 @@ public:
         return false;
     }
 
+    // First non-empty bucket at or after 'from', or num_buckets if none.
+    size_t nextOccupied(size_t from) {
+        if (from >= (size_t) num_buckets) return num_buckets;
+        size_t word = from / 64;
+        unsigned long long bits = occupied[word] & (~0ULL << (from % 64));
+        while (bits == 0) {
+            if (++word == occupied.size()) return num_buckets;
+            bits = occupied[word];
+        }
+        return word * 64 + __builtin_ctzll(bits);
+    }
+
+    // Visits every symbol bucket by bucket in chain order, jumping straight
+    // from one non-empty bucket to the next: visit(symbol, bucket, position).
+    template <class Visitor>
+    void forEach(Visitor visit) {
+        for (size_t i = nextOccupied(0); i < (size_t) num_buckets; i = nextOccupied(i + 1)) {
+            int position = 0;
+            for (SymbolInfo* current = buckets[i]; current != nullptr; current = current->getNext()) {
+                visit(current, i, position++);
+            }
+        }
+    }
+
     void print(const std::string& indent = "") {
         if (os != nullptr) {
             *os << indent << "ScopeTable # " << id << "\n";
-            for (size_t i = 0; i < num_buckets; i++) {
-                SymbolInfo* current = buckets[i];
-                if (current == nullptr) continue;
-               
+            for (size_t i = nextOccupied(0); i < (size_t) num_buckets; i = nextOccupied(i + 1)) {
                 *os << indent << (i) << " --> ";
-                while (current != nullptr) {
+                for (SymbolInfo* current = buckets[i]; current != nullptr; current = current->getNext()) {
                     *os << "< " << current->getName() << " : " << current->getType() << " >";
-                    current = current->getNext();
                 }
                 *os << "\n";
             }
         }
     }
 
+    MemoryStats memoryStats() {
+        MemoryStats stats;
+        stats.scopes = 1;
+        stats.buckets = num_buckets;
+        stats.bucketBytes = num_buckets * sizeof(SymbolInfo*) + occupied.size() * sizeof(unsigned long long);
+        stats.tableBytes = sizeof(BasicScopeTable) - (N > 0 ? stats.bucketBytes : 0);
+        forEach([&](SymbolInfo* symbol, size_t, int) {
+            stats.symbols++;
+            stats.nodeBytes += sizeof(SymbolInfo);
+            stats.addString(symbol->getName());
+            stats.addString(symbol->getType());
+        });
+        return stats;
+    }
+
     double getCollisionsRato() {
         return collisions / (num_buckets * 1.0);
     }
 };
 
-unsigned int (*ScopeTable::hashfunc)(const char*) = sdbmHash;
-std::ostream* ScopeTable::os = nullptr;
+unsigned int (*ScopeTableBase::hashfunc)(const char*) = sdbmHash;
+std::ostream* ScopeTableBase::os = nullptr;
+
+typedef BasicScopeTable<> ScopeTable;
 
 #endif
\ No newline at end of file
@@ -1,37 +1,86 @@
 #ifndef SYMBOLTABLE_H
 #define SYMBOLTABLE_H
 
+#include <array>
+#include <new>
+#include <type_traits>
 #include "ScopeTable.hpp"
 
-class SymbolTable{
-    ScopeTable* currentScope;
-    int num_buckets;
+// Log stream shared by every kind of SymbolTable.
+class SymbolTableBase{
+   protected:
     static std::ostream* outputStream;
 
    public:
-    SymbolTable(int n) : num_buckets(n){
-        currentScope = new ScopeTable(n, nullptr); 
+    static void setOutputStream(std::ostream* os) {
+        outputStream = os;
+    }
+};
+
+// N and Capacity as for BasicScopeTable; the node pool is shared by all
+// scopes. MaxDepth > 0 keeps that many nested scopes inside the table
+// (deeper ones go to the heap), so with all three fixed, e.g.
+// BasicSymbolTable<7, 1024, 32>, a workload within those bounds runs
+// without heap allocation apart from strings too long for std::string's
+// own buffer. SymbolTable is the runtime-sized, heap-backed table.
+template <unsigned N = 0, size_t Capacity = 0, size_t MaxDepth = 0>
+class BasicSymbolTable : public SymbolTableBase{
+    typedef BasicScopeTable<N, Capacity> ScopeType;
+    typedef typename std::aligned_storage<sizeof(ScopeType), alignof(ScopeType)>::type ScopeSlot;
+
+    std::conditional_t<(Capacity > 0), NodePool<Capacity>, char> pool;
+    std::array<ScopeSlot, MaxDepth> scopeSlots; // scopeSlots[d] holds the scope at depth d
+    size_t depth;
+    ScopeType* currentScope;
+    int num_buckets;
+
+    ScopeType* newScope(ScopeType* parent){
+        NodePool<Capacity>* nodes = nullptr;
+        if constexpr (Capacity > 0) nodes = &pool;
+        ScopeType* scope;
+        if (depth < MaxDepth)
+            scope = new (&scopeSlots[depth]) ScopeType(num_buckets, parent, nodes);
+        else
+            scope = new ScopeType(num_buckets, parent, nodes);
+        depth++;
+        return scope;
+    }
+
+    void deleteScope(ScopeType* scope){
+        depth--;
+        if (depth < MaxDepth)
+            scope -> ~ScopeType();
+        else
+            delete scope;
+    }
+
+   public:
+    // n is ignored when N is fixed.
+    BasicSymbolTable(int n) : depth(0), num_buckets(n){
+        currentScope = newScope(nullptr); 
+    }
+
+    BasicSymbolTable() : BasicSymbolTable(N){
+        static_assert(N > 0, "a runtime-sized table needs its bucket count");
     }
 
-    ~SymbolTable(){
+    ~BasicSymbolTable(){
         while (currentScope != nullptr){
-            ScopeTable* parent = currentScope -> getParent();
-            delete currentScope;
+            ScopeType* parent = currentScope -> getParent();
+            deleteScope(currentScope);
             currentScope = parent;
         }
     }
 
-    static void setOutputStream(std::ostream* os) {
-        outputStream = os;
-    }
+    BasicSymbolTable(const BasicSymbolTable&) = delete;
+    BasicSymbolTable& operator=(const BasicSymbolTable&) = delete;
 
     void enterScope(){
-        ScopeTable* newScope = new ScopeTable(num_buckets, currentScope);
-        currentScope = newScope;
+        currentScope = newScope(currentScope);
     }
 
     void exitScope(){
-        ScopeTable* parent = currentScope -> getParent();
+        ScopeType* parent = currentScope -> getParent();
 
         if (parent == nullptr){
             // need to sort out how we can print this to the file
@@ -41,7 +90,7 @@ class SymbolTable{
             }
             return;
         }
-        delete currentScope;
+        deleteScope(currentScope);
         currentScope = parent;
     }
 
@@ -54,7 +103,7 @@ class SymbolTable{
     }
 
     SymbolInfo* lookup(const std::string& name){
-        ScopeTable* curr = currentScope;
+        ScopeType* curr = currentScope;
 
         while (curr != nullptr){
             SymbolInfo* found = curr -> lookup(name);
@@ -70,7 +119,7 @@ class SymbolTable{
     }
     
     void printAllScope(){
-        ScopeTable* curr = currentScope;
+        ScopeType* curr = currentScope;
         std::string indent = "";
         while (curr != nullptr) {
             curr->print(indent);
@@ -79,15 +128,24 @@ class SymbolTable{
         }
     }
 
+    // Totals over every live scope, current one included.
+    MemoryStats memoryStats(){
+        MemoryStats stats;
+        for (ScopeType* curr = currentScope; curr != nullptr; curr = curr -> getParent()){
+            stats += curr -> memoryStats();
+        }
+        return stats;
+    }
+
     double getRatio(){
         int count = 0;
 
-        ScopeTable* parent = currentScope -> getParent();
+        ScopeType* parent = currentScope -> getParent();
         if (parent == nullptr){
             return currentScope -> getCollisionsRato();
         }
 
-        ScopeTable* curr = currentScope;
+        ScopeType* curr = currentScope;
         double ratio = 0;
 
         while (curr != nullptr){
@@ -99,6 +157,8 @@ class SymbolTable{
     }
 };
 
-std::ostream* SymbolTable::outputStream = nullptr;
+std::ostream* SymbolTableBase::outputStream = nullptr;
+
+typedef BasicSymbolTable<> SymbolTable;
 
 #endif
\ No newline at end of file
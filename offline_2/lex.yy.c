@@ -693,7 +693,7 @@ bool undef_escape_character;
 string output;
 string cmnt_str;
 
-SymbolTable st(7);
+BasicSymbolTable<7, 1024, 32> st;
 
 char getASCIIChar(char ch) {
 	switch(ch) {
@@ -2625,6 +2625,7 @@ int main(int argc, char *argv[]){
 
 	log_file << "\nTotal lines: " << yylineno << "\n";
 	log_file << "Total errors: " << error_count << "\n";
+	st.memoryStats().print(log_file);
 
 	fclose(yyin);
 	token_file.close();